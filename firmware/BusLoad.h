@@ -0,0 +1,126 @@
+/**
+ * @file BusLoad.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Estimation of CAN bus utilisation and stretching of periodic
+ * transmissions when the bus is busy.
+ * @version 0.1
+ * @date 2024-09-12
+ * @copyright Copyright (c) 2024
+ *
+ * The CAN controller does not report utilisation, so it is estimated
+ * from the frames which pass through the module: those delivered by
+ * NMEA2000.ParseMessages() and those queued by transmitMessage(). The
+ * library consumes some network management traffic itself, so the
+ * estimate is a lower bound on actual utilisation.
+ *
+ * Frames are counted into a window of Interval milliseconds; at the
+ * end of each window the percentage of bus time they occupied is
+ * folded into an exponentially weighted average which follows a
+ * sustained change in load within a few windows.
+ *
+ * Once the average exceeds Threshold percent, the stretch factor
+ * rises linearly from 1 to MaximumStretch as load rises to 100
+ * percent, in steps of STRETCH_STEP percent so that schedulers are not
+ * disturbed by every small change. Specialisations apply stretch() to
+ * the periods of their periodic transmissions; messages sent in
+ * response to an event are never delayed.
+ */
+
+#ifndef BUSLOAD_H
+#define BUSLOAD_H
+
+/**********************************************************************
+ * @tparam BitRate - the bus bit rate in bits per second.
+ * @tparam BitsPerFrame - the mean length of a frame in bits, including
+ * stuff bits and interframe space.
+ * @tparam Interval - the length of a measurement window in
+ * milliseconds.
+ * @tparam Threshold - the load percentage above which periods are
+ * stretched.
+ * @tparam MaximumStretch - the largest factor by which a period will
+ * be stretched.
+ */
+template <unsigned long BitRate, unsigned int BitsPerFrame, unsigned long Interval, unsigned int Threshold, unsigned int MaximumStretch>
+class BusLoadMonitor {
+  static_assert(Threshold < 100, "BusLoadMonitor threshold must be less than 100 percent");
+  static_assert(MaximumStretch >= 1, "BusLoadMonitor maximum stretch must be at least 1");
+
+  public:
+    static const unsigned int STRETCH_STEP = 25;
+
+    BusLoadMonitor() : frames(0), windowStartedAt(0), load(0), peakLoad(0), stretchFactor(100) {}
+
+    /******************************************************************
+     * @brief Count frames seen on the bus.
+     */
+    void count(unsigned int frames) {
+      this->frames += frames;
+    }
+
+    /******************************************************************
+     * @brief Close the measurement window if it has expired and
+     * update the load estimate and stretch factor.
+     *
+     * @param now - the current time in milliseconds.
+     * @return true if the stretch factor has changed.
+     */
+    bool update(unsigned long now) {
+      unsigned long elapsed = (now - this->windowStartedAt);
+      unsigned int sample;
+      unsigned int stretchFactor;
+
+      if (elapsed < Interval) return(false);
+
+      sample = (unsigned int) (((uint64_t) this->frames * BitsPerFrame * 100000UL) / ((uint64_t) BitRate * elapsed));
+      if (sample > 100) sample = 100;
+      this->frames = 0;
+      this->windowStartedAt = now;
+
+      // Average in 1/256ths of a percent: alpha is 1/4.
+      this->load = (this->load - (this->load >> 2) + (sample << 6));
+      if (this->getLoad() > this->peakLoad) this->peakLoad = this->getLoad();
+
+      stretchFactor = 100;
+      if (this->getLoad() > Threshold) {
+        stretchFactor += (((MaximumStretch - 1) * 100 * (this->getLoad() - Threshold)) / (100 - Threshold));
+        stretchFactor -= (stretchFactor % STRETCH_STEP);
+      }
+      if (stretchFactor == this->stretchFactor) return(false);
+      this->stretchFactor = stretchFactor;
+      return(true);
+    }
+
+    /******************************************************************
+     * @brief Get the estimated bus load in percent.
+     */
+    unsigned int getLoad() { return(this->load >> 8); }
+
+    /******************************************************************
+     * @brief Get the highest estimated bus load in percent.
+     */
+    unsigned int getPeakLoad() { return(this->peakLoad); }
+
+    /******************************************************************
+     * @brief Get the current stretch factor in percent.
+     */
+    unsigned int getStretch() { return(this->stretchFactor); }
+
+    /******************************************************************
+     * @brief Stretch a transmission period by the current factor.
+     *
+     * @param period - the configured period.
+     * @return the period to be used at the current bus load.
+     */
+    unsigned long stretch(unsigned long period) {
+      return((period * this->stretchFactor) / 100);
+    }
+
+  private:
+    unsigned long frames;
+    unsigned long windowStartedAt;
+    unsigned int load;
+    unsigned int peakLoad;
+    unsigned int stretchFactor;
+};
+
+#endif
@@ -0,0 +1,110 @@
+/**
+ * @file ConfigurationObserver.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Notification of module configuration changes to interested
+ * subsystems.
+ * @version 0.1
+ * @date 2024-09-09
+ * @copyright Copyright (c) 2024
+ *
+ * The ModuleConfiguration library offers a hook only before a value
+ * is written (its validation callback). NOP100's validation callback
+ * therefore records each accepted change here, and notify() is called
+ * from loop(). By then the new value has been stored, and each
+ * subscriber whose index range includes a changed index is called
+ * with that index and its new value.
+ *
+ * Subscribers re-derive whatever state depends on the changed index.
+ * Changes made through the operator interface or by
+ * ModuleConfiguration.setByte() therefore take effect on the next
+ * pass of loop(), without a restart. ModuleConfiguration.erase()
+ * bypasses the validation callback, so whoever calls it must call
+ * recordAll().
+ */
+
+#ifndef CONFIGURATIONOBSERVER_H
+#define CONFIGURATIONOBSERVER_H
+
+/**********************************************************************
+ * @tparam Size - the size of the module configuration in bytes.
+ * @tparam SubscriberCount - the maximum number of subscriptions.
+ */
+template <unsigned int Size, unsigned int SubscriberCount>
+class ConfigurationObserver {
+  public:
+    typedef void (*tHandler)(unsigned int index, unsigned char value);
+
+    ConfigurationObserver() : subscriptionCount(0), rejectedCount(0) {
+      memset(this->pending, 0, sizeof(this->pending));
+    }
+
+    /******************************************************************
+     * @brief Subscribe a handler to changes in a range of configuration
+     * indices.
+     *
+     * @param first - the first index of interest.
+     * @param last - the last index of interest.
+     * @param handler - function to be called with each changed index
+     * in the range.
+     * @return false if there is no room for the subscription, which
+     * is then also counted by getRejectedCount().
+     */
+    bool subscribe(unsigned int first, unsigned int last, tHandler handler) {
+      if (this->subscriptionCount == SubscriberCount) {
+        this->rejectedCount++;
+        return(false);
+      }
+      this->subscriptions[this->subscriptionCount++] = { first, last, handler };
+      return(true);
+    }
+
+    /******************************************************************
+     * @brief Get the number of subscriptions refused for lack of room.
+     */
+    unsigned int getRejectedCount() { return(this->rejectedCount); }
+
+    /******************************************************************
+     * @brief Record that a configuration index is about to change.
+     */
+    void record(unsigned int index) {
+      if (index < Size) this->pending[index / 32] |= (1UL << (index % 32));
+    }
+
+    /******************************************************************
+     * @brief Record that every configuration index has changed, as
+     * when the configuration is erased and restored to its defaults
+     * without passing through the validation callback.
+     */
+    void recordAll() {
+      for (unsigned int index = 0; index < Size; index++) this->record(index);
+    }
+
+    /******************************************************************
+     * @brief Notify subscribers of recorded changes.
+     *
+     * @param configuration - a ModuleConfiguration object.
+     */
+    template <class C> void notify(C &configuration) {
+      for (unsigned int word = 0; word < ((Size + 31) / 32); word++) {
+        uint32_t changes = this->pending[word];
+
+        this->pending[word] = 0;
+        for (; changes; changes &= (changes - 1)) {
+          unsigned int index = ((word * 32) + __builtin_ctz(changes));
+          for (unsigned int s = 0; s < this->subscriptionCount; s++) {
+            if ((index >= this->subscriptions[s].first) && (index <= this->subscriptions[s].last)) this->subscriptions[s].handler(index, configuration.getByte(index));
+          }
+        }
+      }
+    }
+
+  private:
+    typedef struct { unsigned int first; unsigned int last; tHandler handler; } tSubscription;
+
+    tSubscription subscriptions[(SubscriberCount > 0)?SubscriberCount:1];
+    unsigned int subscriptionCount;
+    unsigned int rejectedCount;
+    uint32_t pending[(Size + 31) / 32];
+};
+
+#endif
@@ -0,0 +1,112 @@
+/**
+ * @file EepromJournal.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Wear-levelled storage of a single byte value in EEPROM.
+ * @version 0.1
+ * @date 2024-09-19
+ * @copyright Copyright (c) 2024
+ *
+ * A value which changes often in service would soon wear out the
+ * EEPROM cell which holds it. EepromJournal spreads the writes over a
+ * ring of SlotCount records, each written in turn, so that any one
+ * cell is written only once in every SlotCount saves.
+ *
+ * Each record holds a sequence number, the value and a check byte.
+ * begin() takes the valid record with the most recent sequence number
+ * as the stored value. A record is written sequence first and check
+ * last, so a write interrupted by loss of power leaves a record which
+ * all but certainly fails its check and the previous record stands.
+ * Erased EEPROM holds no valid records.
+ */
+
+#ifndef EEPROMJOURNAL_H
+#define EEPROMJOURNAL_H
+
+/**********************************************************************
+ * @tparam Address - the EEPROM address of the first record.
+ * @tparam SlotCount - the number of records in the ring.
+ */
+template <unsigned int Address, unsigned int SlotCount>
+class EepromJournal {
+  static_assert((SlotCount >= 2) && (SlotCount <= 128), "EepromJournal slot count must be between 2 and 128");
+
+  public:
+    static const unsigned int RECORD_SIZE = 3;
+    static const unsigned int SIZE = (SlotCount * RECORD_SIZE);
+
+    EepromJournal() : slot(SlotCount - 1), sequence(255), value(0), writeCount(0) {}
+
+    /******************************************************************
+     * @brief Recover the most recently saved value.
+     *
+     * Sequence numbers are compared modulo 256; no two valid records
+     * can be more than SlotCount apart, so the comparison is never
+     * ambiguous.
+     *
+     * @return true if a saved value was found.
+     */
+    bool begin() {
+      bool found = false;
+      uint8_t sequence;
+      uint8_t value;
+
+      for (unsigned int s = 0; s < SlotCount; s++) {
+        if (!this->readRecord(s, sequence, value)) continue;
+        if ((!found) || ((int8_t) (sequence - this->sequence) > 0)) {
+          this->slot = s;
+          this->sequence = sequence;
+          this->value = value;
+          found = true;
+        }
+      }
+      return(found);
+    }
+
+    /******************************************************************
+     * @brief Get the most recently saved value.
+     */
+    uint8_t read() { return(this->value); }
+
+    /******************************************************************
+     * @brief Save a value in the next record of the ring.
+     *
+     * @param value - the value to be saved.
+     */
+    void write(uint8_t value) {
+      unsigned int address;
+
+      this->slot = ((this->slot + 1) % SlotCount);
+      this->sequence++;
+      this->value = value;
+      address = (Address + (this->slot * RECORD_SIZE));
+      EEPROM.write(address, this->sequence);
+      EEPROM.write(address + 1, this->value);
+      EEPROM.write(address + 2, check(this->sequence, this->value));
+      this->writeCount++;
+    }
+
+    /******************************************************************
+     * @brief Get the number of values saved since startup.
+     */
+    unsigned long getWriteCount() { return(this->writeCount); }
+
+  private:
+    static uint8_t check(uint8_t sequence, uint8_t value) {
+      return((uint8_t) ~(sequence ^ value ^ 0x5A));
+    }
+
+    bool readRecord(unsigned int slot, uint8_t &sequence, uint8_t &value) {
+      unsigned int address = (Address + (slot * RECORD_SIZE));
+
+      sequence = EEPROM.read(address);
+      value = EEPROM.read(address + 1);
+      return(EEPROM.read(address + 2) == check(sequence, value));
+    }
+
+    unsigned int slot;
+    uint8_t sequence;
+    uint8_t value;
+    unsigned long writeCount;
+};
+
+#endif
@@ -0,0 +1,244 @@
+/**
+ * @file FixedPointFilter.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Fixed-point FIR decimation and IIR low-pass filter kernels.
+ * @version 0.1
+ * @date 2024-08-26
+ * @copyright Copyright (c) 2024
+ *
+ * Samples are signed 16-bit Q15 values. FIR arithmetic accumulates
+ * in 64 bits and IIR arithmetic uses Q30 coefficients, 32-bit state
+ * and a 64-bit accumulator, so that the very low cutoff frequencies
+ * needed to settle sloshing tank senders neither overflow nor stall
+ * in a dead band.
+ *
+ * On a processor with the ARM DSP extension (the Teensy 4's
+ * Cortex-M7) the FIR inner loop processes two taps per instruction
+ * with SMLALD; elsewhere an exact C equivalent of that instruction is
+ * used. The header depends on nothing beyond the C library, so the
+ * kernels can be compiled and checked on a host against a floating
+ * point reference.
+ */
+
+#ifndef FIXEDPOINTFILTER_H
+#define FIXEDPOINTFILTER_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+/**********************************************************************
+ * @brief Dual signed 16 x 16 multiply with 64-bit accumulate.
+ *
+ * Returns acc + (x.lo * y.lo) + (x.hi * y.hi) where x and y each pack
+ * two Q15 values.
+ */
+static inline int64_t fixedPointSmlald(uint32_t x, uint32_t y, int64_t acc) {
+  #if defined(__ARM_FEATURE_DSP)
+  uint32_t lo = (uint32_t) acc;
+  uint32_t hi = (uint32_t) ((uint64_t) acc >> 32);
+  asm ("smlald %0, %1, %2, %3" : "+r" (lo), "+r" (hi) : "r" (x), "r" (y));
+  return((int64_t) (((uint64_t) hi << 32) | lo));
+  #else
+  return(acc + ((int32_t) (int16_t) x * (int16_t) y) + ((int32_t) (int16_t) (x >> 16) * (int16_t) (y >> 16)));
+  #endif
+}
+
+static inline int16_t fixedPointSaturate16(int64_t value) {
+  return((value > INT16_MAX)?INT16_MAX:((value < INT16_MIN)?INT16_MIN:(int16_t) value));
+}
+
+static inline int32_t fixedPointSaturate32(int64_t value) {
+  return((value > INT32_MAX)?INT32_MAX:((value < INT32_MIN)?INT32_MIN:(int32_t) value));
+}
+
+/**********************************************************************
+ * @brief Linear phase low-pass FIR filter and decimator.
+ *
+ * Every sample is stored, but the filter output is only computed on
+ * every Factor'th sample, so the cost per input sample is Taps/Factor
+ * multiply-accumulates.
+ *
+ * History is kept twice over in a buffer of 2 * Taps samples so that
+ * the filter window is always contiguous and can be read in pairs.
+ *
+ * @tparam Taps - filter length, which must be even.
+ * @tparam Factor - decimation factor.
+ */
+template <unsigned int Taps, unsigned int Factor>
+class FirDecimator {
+  static_assert((Taps % 2) == 0, "FirDecimator requires an even number of taps");
+  static_assert(Factor > 0, "FirDecimator requires a non-zero decimation factor");
+
+  public:
+    static const unsigned int TAPS = Taps;
+    static const unsigned int FACTOR = Factor;
+
+    FirDecimator() : position(0), phase(0) {
+      memset(this->coefficients, 0, sizeof(this->coefficients));
+      memset(this->history, 0, sizeof(this->history));
+      this->coefficients[Taps / 2] = INT16_MAX;
+    }
+
+    /******************************************************************
+     * @brief Design a Hamming windowed-sinc low-pass filter.
+     *
+     * Coefficients are quantised to Q15 and the centre taps are
+     * adjusted so that they sum to exactly 32768, giving unity gain at
+     * DC.
+     *
+     * @param cutoff - cutoff frequency as a fraction of the input
+     * sample rate (0 < cutoff < 0.5). 0.5 / Factor is a sensible
+     * choice.
+     */
+    void design(double cutoff) {
+      double h[Taps];
+      double scale = 0.0;
+      int32_t sum = 0;
+
+      for (unsigned int i = 0; i < Taps; i++) {
+        double n = (i - ((Taps - 1) / 2.0));
+        h[i] = (sin(2.0 * M_PI * cutoff * n) / (M_PI * n)) * (0.54 - (0.46 * cos((2.0 * M_PI * i) / (Taps - 1))));
+        scale += h[i];
+      }
+      for (unsigned int i = 0; i < Taps; i++) {
+        this->coefficients[i] = fixedPointSaturate16(lround((h[i] / scale) * 32768.0));
+        sum += this->coefficients[i];
+      }
+      this->coefficients[(Taps / 2) - 1] += ((32768 - sum) / 2);
+      this->coefficients[Taps / 2] += ((32768 - sum) - ((32768 - sum) / 2));
+    }
+
+    /******************************************************************
+     * @brief Fill the filter history with a constant value so that
+     * the output starts at that value rather than ramping up from
+     * zero.
+     */
+    void reset(int16_t value) {
+      for (unsigned int i = 0; i < (2 * Taps); i++) this->history[i] = value;
+      this->position = 0;
+      this->phase = 0;
+    }
+
+    /******************************************************************
+     * @brief Add a sample to the filter.
+     *
+     * @param sample - the new Q15 input sample.
+     * @param output - set to the filter output when one is produced.
+     * @return true if output has been set.
+     */
+    bool push(int16_t sample, int16_t &output) {
+      this->history[this->position] = sample;
+      this->history[this->position + Taps] = sample;
+      if (++this->position == Taps) this->position = 0;
+      if (++this->phase < Factor) return(false);
+      this->phase = 0;
+      output = fixedPointSaturate16((dotProduct(this->coefficients, &this->history[this->position], Taps) + (1 << 14)) >> 15);
+      return(true);
+    }
+
+    const int16_t *getCoefficients() const { return(this->coefficients); }
+
+    /******************************************************************
+     * @brief Sum of products of two Q15 vectors of even length.
+     */
+    static int64_t dotProduct(const int16_t *a, const int16_t *b, unsigned int length) {
+      int64_t acc = 0;
+      uint32_t x, y;
+
+      for (unsigned int i = 0; i < length; i += 2) {
+        memcpy(&x, &a[i], sizeof(x));
+        memcpy(&y, &b[i], sizeof(y));
+        acc = fixedPointSmlald(x, y, acc);
+      }
+      return(acc);
+    }
+
+  private:
+    int16_t coefficients[Taps];
+    int16_t history[2 * Taps];
+    unsigned int position;
+    unsigned int phase;
+};
+
+/**********************************************************************
+ * @brief Second order Butterworth low-pass IIR filter.
+ *
+ * The filter is a direct form I biquad computing
+ *
+ *   y[n] = b0.x[n] + b1.x[n-1] + b2.x[n-2] + a1.y[n-1] + a2.y[n-2]
+ *
+ * with coefficients in Q30 (note the sign convention for a1 and a2)
+ * and input, output and state in Q31.
+ *
+ * The fraction discarded when the accumulator is scaled back to Q31
+ * is carried into the next sample. Without this the filter's output
+ * can stick short of its input by an amount which grows as the cutoff
+ * falls, reaching tens of ADC counts at the cutoffs used on tank
+ * senders.
+ */
+class BiquadLowPass {
+  public:
+    BiquadLowPass() : b0(1L << 30), b1(0), b2(0), a1(0), a2(0) {
+      this->reset(0);
+    }
+
+    /******************************************************************
+     * @brief Compute coefficients for a given cutoff.
+     *
+     * The numerator is derived from the quantised denominator so that
+     * the filter has exactly unity gain at DC however low the cutoff.
+     *
+     * @param cutoff - cutoff frequency as a fraction of the filter's
+     * sample rate (0 < cutoff < 0.5).
+     */
+    void design(double cutoff) {
+      double w = (2.0 * M_PI * cutoff);
+      double alpha = (sin(w) / (2.0 * M_SQRT1_2));
+      double a0 = (1.0 + alpha);
+      int64_t d;
+
+      this->a1 = (int32_t) llround(((2.0 * cos(w)) / a0) * 1073741824.0);
+      this->a2 = (int32_t) llround((-(1.0 - alpha) / a0) * 1073741824.0);
+      d = ((1LL << 30) - this->a1 - this->a2);
+      this->b0 = this->b2 = (int32_t) (d / 4);
+      this->b1 = (int32_t) (d - (2 * (d / 4)));
+    }
+
+    /******************************************************************
+     * @brief Preset the filter state to a steady input value.
+     */
+    void reset(int16_t value) {
+      this->x1 = this->x2 = this->y1 = this->y2 = ((int32_t) value * 65536);
+      this->remainder = 0;
+    }
+
+    /******************************************************************
+     * @brief Filter a Q15 sample.
+     *
+     * @return The filter output in Q31.
+     */
+    int32_t process(int16_t sample) {
+      int32_t x0 = ((int32_t) sample * 65536);
+      int64_t acc = ((int64_t) this->b0 * x0) + ((int64_t) this->b1 * this->x1) + ((int64_t) this->b2 * this->x2) + ((int64_t) this->a1 * this->y1) + ((int64_t) this->a2 * this->y2) + this->remainder;
+      int32_t y0 = fixedPointSaturate32(acc >> 30);
+
+      this->remainder = (acc - ((int64_t) y0 * (1LL << 30)));
+      if ((this->remainder < 0) || (this->remainder >= (1LL << 30))) this->remainder = 0;
+
+      this->x2 = this->x1;
+      this->x1 = x0;
+      this->y2 = this->y1;
+      this->y1 = y0;
+      return(y0);
+    }
+
+    int32_t getOutput() const { return(this->y1); }
+
+  private:
+    int32_t b0, b1, b2, a1, a2;
+    int32_t x1, x2, y1, y2;
+    int64_t remainder;
+};
+
+#endif
@@ -0,0 +1,343 @@
+/**
+ * @file LocalLogic.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Rule engine which lets module inputs drive module outputs
+ * without a round trip through an external controller.
+ * @version 0.1
+ * @date 2024-08-12
+ * @copyright Copyright (c) 2024
+ *
+ * Rules are stored in the module configuration as a block which
+ * starts with RemoteBankCount switchbank instance numbers followed by
+ * RuleCount rules of RULE_SIZE bytes each:
+ *
+ * | Offset | Content                                                  |
+ * | ---:   | :---                                                     |
+ * | 0      | Operator, optionally ORed with INVERT.                   |
+ * | 1      | Channel reference for input A.                           |
+ * | 2      | Channel reference for input B.                           |
+ * | 3      | Local channel number of the output.                      |
+ * | 4      | Timer parameter in 100s of milliseconds.                 |
+ *
+ * A channel reference less than 128 is a local channel number. A
+ * reference with bit 7 set is a remote channel: bits 5 and 6 select
+ * one of the mirrored remote switchbanks and bits 0 through 4 give the
+ * channel number within that bank less one. A switchbank instance of
+ * 255 leaves its slot unused.
+ *
+ * A rule is active when its operator is not OP_NONE. No two active
+ * rules may drive the same output and no active rule may read a
+ * remote switchbank slot which is unused, so a rule's inputs and
+ * output should be entered before its operator.
+ *
+ * Remote switchbank states are mirrored from received PGN 127501
+ * messages. Local channel states are supplied by the specialisation.
+ *
+ * Evaluation is incremental: a change on a channel marks only the
+ * rules which read it as dirty and evaluate() processes at most one
+ * pass over the dirty rules, so the cost of a loop() pass is bounded
+ * by RuleCount however the rules are chained.
+ */
+
+#ifndef LOCALLOGIC_H
+#define LOCALLOGIC_H
+
+template <unsigned int RuleCount, unsigned int RemoteBankCount, unsigned int LocalChannelCount>
+class LocalLogicEngine {
+  static_assert(RuleCount <= 32, "LocalLogicEngine supports at most 32 rules");
+  static_assert(RemoteBankCount <= 4, "LocalLogicEngine supports at most 4 remote switchbanks");
+  static_assert(LocalChannelCount <= 128, "LocalLogicEngine supports at most 128 local channels");
+
+  public:
+    enum tOperator : uint8_t { OP_NONE, OP_AND, OP_OR, OP_XOR, OP_LATCH, OP_DELAY, OP_PULSE, OP_LIMIT };
+    enum tField : uint8_t { FIELD_OPERATOR, FIELD_INPUT_A, FIELD_INPUT_B, FIELD_OUTPUT, FIELD_PARAMETER };
+
+    static const uint8_t INVERT = 0x80;
+    static const uint8_t REMOTE = 0x80;
+    static const unsigned int REMOTE_CHANNEL_COUNT = 28;
+    static const unsigned int RULE_SIZE = 5;
+    static const unsigned int CONFIGURATION_SIZE = RemoteBankCount + (RuleCount * RULE_SIZE);
+
+    /******************************************************************
+     * @brief Construct a new engine.
+     *
+     * @param configurationIndex - index of the engine's block in the
+     * module configuration.
+     * @param outputHandler - function called when a rule output
+     * changes state.
+     */
+    LocalLogicEngine(unsigned int configurationIndex, void (*outputHandler)(unsigned int channel, bool state)) :
+      configurationIndex(configurationIndex), outputHandler(outputHandler), dirty(0), timed(0), stale(true) {
+      memset(this->rules, 0, sizeof(this->rules));
+      memset(this->local, 0, sizeof(this->local));
+      memset(this->remote, 0, sizeof(this->remote));
+      memset(this->remoteInstances, 0xff, sizeof(this->remoteInstances));
+    }
+
+    /******************************************************************
+     * @brief Check whether a configuration index lies in the engine's
+     * block.
+     */
+    bool owns(unsigned int index) {
+      return((index >= this->configurationIndex) && (index < (this->configurationIndex + CONFIGURATION_SIZE)));
+    }
+
+    /******************************************************************
+     * @brief Validate a proposed value for a configuration index in
+     * the engine's block.
+     *
+     * Operators must be known, inputs must refer to an existing local
+     * channel or to a channel in one of the remote switchbank slots
+     * and outputs must refer to an existing local channel. The rule
+     * table which would result from the change must then pass
+     * validateTable().
+     *
+     * @param configuration - a ModuleConfiguration object holding the
+     * current configuration.
+     * @param index - the configuration index to be changed.
+     * @param value - the proposed value.
+     */
+    template <class C> bool validate(C &configuration, unsigned int index, unsigned char value) {
+      unsigned int offset = (index - this->configurationIndex);
+
+      if (offset >= RemoteBankCount) {
+        switch ((offset - RemoteBankCount) % RULE_SIZE) {
+          case FIELD_OPERATOR: if ((value & ~INVERT) >= OP_LIMIT) return(false); break;
+          case FIELD_INPUT_A: if (!isValidReference(value)) return(false); break;
+          case FIELD_INPUT_B: if (!isValidReference(value)) return(false); break;
+          case FIELD_OUTPUT: if (value >= LocalChannelCount) return(false); break;
+          default: break;
+        }
+      }
+      return(this->validateTable(configuration, offset, value));
+    }
+
+    /******************************************************************
+     * @brief Flag that the engine's configuration block has changed
+     * and must be reloaded by configure().
+     */
+    void invalidate() { this->stale = true; }
+    bool isStale() { return(this->stale); }
+
+    /******************************************************************
+     * @brief Load remote switchbank instances and rules from the
+     * module configuration and schedule every rule for evaluation.
+     *
+     * @param configuration - a ModuleConfiguration object.
+     */
+    template <class C> void configure(C &configuration) {
+      unsigned int index = this->configurationIndex;
+
+      for (unsigned int b = 0; b < RemoteBankCount; b++) this->remoteInstances[b] = configuration.getByte(index++);
+      for (unsigned int r = 0; r < RuleCount; r++) {
+        tRule *rule = &this->rules[r];
+        rule->op = configuration.getByte(index++);
+        rule->a = configuration.getByte(index++);
+        rule->b = configuration.getByte(index++);
+        rule->output = configuration.getByte(index++);
+        rule->parameter = configuration.getByte(index++);
+        rule->lastA = rule->lastB = rule->latched = false;
+      }
+      this->dirty = (RuleCount == 32)?0xffffffffUL:((1UL << RuleCount) - 1);
+      this->timed = 0;
+      this->stale = false;
+    }
+
+    /******************************************************************
+     * @brief Update the state of a local channel.
+     */
+    void setLocal(unsigned int channel, bool state) {
+      if ((channel < LocalChannelCount) && (this->getLocal(channel) != state)) {
+        this->local[channel / 32] ^= (1UL << (channel % 32));
+        this->markDependents(channel, 0);
+      }
+    }
+
+    bool getLocal(unsigned int channel) {
+      return((channel < LocalChannelCount) && (this->local[channel / 32] & (1UL << (channel % 32))));
+    }
+
+    /******************************************************************
+     * @brief Update the mirror of a remote switchbank from a received
+     * PGN 127501 message.
+     *
+     * Messages from switchbanks which are not mirrored are ignored.
+     */
+    void receiveSwitchbankStatus(uint8_t instance, tN2kBinaryStatus status) {
+      for (unsigned int b = 0; b < RemoteBankCount; b++) {
+        if (this->remoteInstances[b] == instance) {
+          uint32_t bits = 0;
+          for (unsigned int c = 0; c < REMOTE_CHANNEL_COUNT; c++) {
+            if (N2kGetStatusOnBinaryStatus(status, (c + 1)) == N2kOnOff_On) bits |= (1UL << c);
+          }
+          uint32_t changed = (bits ^ this->remote[b]);
+          this->remote[b] = bits;
+          if (changed) this->markDependents(REMOTE | (b << 5), changed);
+        }
+      }
+    }
+
+    /******************************************************************
+     * @brief Evaluate dirty rules and rules with expiring timers.
+     *
+     * Outputs which change are reported through the output handler
+     * and fed back as local channel states, so rules which read
+     * another rule's output are evaluated on the next call.
+     *
+     * @param now - the current time in milliseconds.
+     */
+    void evaluate(unsigned long now) {
+      uint32_t pending = this->dirty;
+
+      this->dirty = 0;
+      for (uint32_t timers = this->timed; timers; timers &= (timers - 1)) {
+        unsigned int r = __builtin_ctz(timers);
+        if ((now - this->rules[r].timerStart) >= (this->rules[r].parameter * 100UL)) pending |= (1UL << r);
+      }
+      for (; pending; pending &= (pending - 1)) {
+        this->evaluateRule(__builtin_ctz(pending), now);
+      }
+    }
+
+  private:
+    typedef struct {
+      uint8_t op;
+      uint8_t a;
+      uint8_t b;
+      uint8_t output;
+      uint8_t parameter;
+      bool lastA;
+      bool lastB;
+      bool latched;
+      unsigned long timerStart;
+    } tRule;
+
+    unsigned int configurationIndex;
+    void (*outputHandler)(unsigned int channel, bool state);
+    tRule rules[RuleCount];
+    uint32_t local[(LocalChannelCount + 31) / 32];
+    uint32_t remote[RemoteBankCount + 1];
+    uint8_t remoteInstances[RemoteBankCount + 1];
+    uint32_t dirty;
+    uint32_t timed;
+    bool stale;
+
+    /******************************************************************
+     * @brief Check the rule table which would result from changing
+     * one byte of the engine's block.
+     *
+     * Rejects a table in which two active rules drive the same output
+     * or an active rule reads a remote switchbank slot whose instance
+     * is 255. Input B is only checked for operators which read it.
+     *
+     * @param configuration - a ModuleConfiguration object.
+     * @param changedOffset - offset in the block of the changed byte.
+     * @param changedValue - the proposed value of the changed byte.
+     */
+    template <class C> bool validateTable(C &configuration, unsigned int changedOffset, unsigned char changedValue) {
+      uint32_t outputs[(LocalChannelCount + 31) / 32];
+      uint8_t instances[RemoteBankCount + 1];
+      uint8_t rule[RULE_SIZE];
+      unsigned int offset = 0;
+
+      memset(outputs, 0, sizeof(outputs));
+      for (unsigned int b = 0; b < RemoteBankCount; b++, offset++) {
+        instances[b] = (offset == changedOffset)?changedValue:configuration.getByte(this->configurationIndex + offset);
+      }
+      for (unsigned int r = 0; r < RuleCount; r++) {
+        for (unsigned int f = 0; f < RULE_SIZE; f++, offset++) {
+          rule[f] = (offset == changedOffset)?changedValue:configuration.getByte(this->configurationIndex + offset);
+        }
+        switch (rule[FIELD_OPERATOR] & ~INVERT) {
+          case OP_NONE:
+            continue;
+          case OP_AND: case OP_OR: case OP_XOR: case OP_LATCH:
+            if (!isMirrored(instances, rule[FIELD_INPUT_B])) return(false);
+            break;
+          default:
+            break;
+        }
+        if (!isMirrored(instances, rule[FIELD_INPUT_A])) return(false);
+        if (rule[FIELD_OUTPUT] >= LocalChannelCount) return(false);
+        if (outputs[rule[FIELD_OUTPUT] / 32] & (1UL << (rule[FIELD_OUTPUT] % 32))) return(false);
+        outputs[rule[FIELD_OUTPUT] / 32] |= (1UL << (rule[FIELD_OUTPUT] % 32));
+      }
+      return(true);
+    }
+
+    static bool isMirrored(const uint8_t *instances, uint8_t reference) {
+      return(!(reference & REMOTE) || (instances[(reference >> 5) & 0x03] != 0xff));
+    }
+
+    static bool isValidReference(uint8_t reference) {
+      if (reference & REMOTE) return((((reference >> 5) & 0x03) < RemoteBankCount) && ((reference & 0x1f) < REMOTE_CHANNEL_COUNT));
+      return(reference < LocalChannelCount);
+    }
+
+    bool read(uint8_t reference) {
+      if (reference & REMOTE) return(this->remote[(reference >> 5) & 0x03] & (1UL << (reference & 0x1f)));
+      return(this->getLocal(reference));
+    }
+
+    /******************************************************************
+     * @brief Mark as dirty every rule which reads a changed channel.
+     *
+     * @param reference - a local channel reference, or a remote
+     * reference whose channel bits are ignored.
+     * @param changed - for a remote reference, a bitmap of the
+     * channels in the bank which have changed.
+     */
+    void markDependents(uint8_t reference, uint32_t changed) {
+      for (unsigned int r = 0; r < RuleCount; r++) {
+        if (this->rules[r].op == OP_NONE) continue;
+        if (this->dependsOn(this->rules[r].a, reference, changed) || this->dependsOn(this->rules[r].b, reference, changed)) this->dirty |= (1UL << r);
+      }
+    }
+
+    static bool dependsOn(uint8_t input, uint8_t reference, uint32_t changed) {
+      if (reference & REMOTE) return(((input & ~0x1f) == reference) && (changed & (1UL << (input & 0x1f))));
+      return(input == reference);
+    }
+
+    void evaluateRule(unsigned int r, unsigned long now) {
+      tRule *rule = &this->rules[r];
+      bool a = this->read(rule->a);
+      bool b = this->read(rule->b);
+      bool timerExpired = ((this->timed & (1UL << r)) && ((now - rule->timerStart) >= (rule->parameter * 100UL)));
+      bool state;
+
+      switch (rule->op & ~INVERT) {
+        case OP_AND: state = (a && b); break;
+        case OP_OR: state = (a || b); break;
+        case OP_XOR: state = (a != b); break;
+        case OP_LATCH:
+          if (a && !rule->lastA) rule->latched = true;
+          if (b && !rule->lastB) rule->latched = false;
+          state = rule->latched;
+          break;
+        case OP_DELAY:
+          if (a && !rule->lastA) { rule->timerStart = now; this->timed |= (1UL << r); }
+          if (!a) this->timed &= ~(1UL << r);
+          if (timerExpired) { rule->latched = true; this->timed &= ~(1UL << r); }
+          if (!a) rule->latched = false;
+          state = rule->latched;
+          break;
+        case OP_PULSE:
+          if (a && !rule->lastA) { rule->latched = true; rule->timerStart = now; this->timed |= (1UL << r); }
+          if (timerExpired) { rule->latched = false; this->timed &= ~(1UL << r); }
+          state = rule->latched;
+          break;
+        default:
+          return;
+      }
+      rule->lastA = a;
+      rule->lastB = b;
+      if (rule->op & INVERT) state = !state;
+      if (state != this->getLocal(rule->output)) {
+        this->setLocal(rule->output, state);
+        this->outputHandler(rule->output, state);
+      }
+    }
+};
+
+#endif
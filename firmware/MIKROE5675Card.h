@@ -0,0 +1,144 @@
+/**
+ * @file MIKROE5675Card.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief MikroBus card driver for the MikroE 5675 Relay 5 Click.
+ * @version 0.1
+ * @date 2024-08-05
+ * @copyright Copyright (c) 2024
+ *
+ * The card's relays are driven from the low order pins of a PCA9538A
+ * I2C port expander. All register traffic after begin() is carried by
+ * PeripheralIO, so neither command() nor poll() blocks loop().
+ */
+
+#ifndef MIKROE5675CARD_H
+#define MIKROE5675CARD_H
+
+#include <i2c_driver_wire.h>
+#include "PeripheralIO.h"
+#include "MikroBus.h"
+
+/**********************************************************************
+ * @brief Relay output card driver.
+ *
+ * begin() loads the expander's output register with the most recently
+ * commanded states and then configures the relay pins as outputs, so
+ * the relays come up in those states without a glitch. It is the only
+ * blocking operation and may be called more than once.
+ *
+ * command() sets the card's relays from a bitmap in which bit 0
+ * corresponds to relay channel 1. Before begin() it only records the
+ * states for begin() to apply. If the I2C queue is full the write is
+ * retried from poll(), the most recent command winning.
+ *
+ * Relay states are read back every Interval milliseconds and Callback
+ * is invoked with the current states. A read which was queued before
+ * the most recent command is discarded, so Callback never reports a
+ * state which has already been superseded.
+ *
+ * @tparam Socket - the MikroBusSocket hosting the card.
+ * @tparam Address - I2C address set by the card's address jumpers.
+ * @tparam Callback - function to be called with relay states.
+ * @tparam Interval - polling interval in milliseconds.
+ */
+template <class Socket, uint8_t Address, void (*Callback)(uint16_t), unsigned long Interval>
+class MIKROE5675Card : public MikroBusCard<MIKROE5675Card<Socket, Address, Callback, Interval>, Socket> {
+  public:
+    static const unsigned int CHANNEL_COUNT = 3;
+
+    MIKROE5675Card() : status(0), begun(false), writePending(false), writeSequence(0), readSequence(0), polledAt(0) {
+      this->initialiseTransaction(this->writeTransaction, this->writeBuffer, 2, 0, 0);
+      this->initialiseTransaction(this->readTransaction, this->readRegister, 1, this->readBuffer, 1);
+    }
+
+    void onBegin() {
+      pinMode(Socket::RST, OUTPUT);
+      digitalWrite(Socket::RST, HIGH);
+      Wire.begin();
+      this->writeRegister(REGISTER_OUTPUT, this->status);
+      this->writeRegister(REGISTER_CONFIGURATION, (uint8_t) ~CHANNEL_MASK);
+      this->writePending = false;
+      this->begun = true;
+    }
+
+    void onPoll() {
+      unsigned long now = millis();
+
+      if (this->readTransaction.status == PeripheralIO::STATUS_DONE) {
+        this->readTransaction.status = PeripheralIO::STATUS_IDLE;
+        if ((this->readSequence == this->writeSequence) && (!this->writePending)) Callback(this->readBuffer[0] & CHANNEL_MASK);
+      }
+      if ((now - this->polledAt) >= Interval) {
+        this->polledAt = now;
+        if (this->writeTransaction.status == PeripheralIO::STATUS_ERROR) {
+          this->writeTransaction.status = PeripheralIO::STATUS_IDLE;
+          this->writePending = true;
+        }
+        if (!PeripheralBus.isBusy(this->readTransaction)) {
+          this->readSequence = this->writeSequence;
+          PeripheralBus.submit(this->readTransaction);
+        }
+      }
+      this->writeMaybe();
+    }
+
+    bool onCommand(uint32_t value) {
+      this->status = (value & CHANNEL_MASK);
+      if (!this->begun) return(true);
+      this->writeSequence++;
+      this->writePending = true;
+      this->writeMaybe();
+      return(true);
+    }
+
+  private:
+    static const uint8_t REGISTER_INPUT = 0;
+    static const uint8_t REGISTER_OUTPUT = 1;
+    static const uint8_t REGISTER_CONFIGURATION = 3;
+    static const uint8_t CHANNEL_MASK = ((1 << CHANNEL_COUNT) - 1);
+
+    uint8_t status;
+    bool begun;
+    bool writePending;
+    unsigned long writeSequence;
+    unsigned long readSequence;
+    unsigned long polledAt;
+    uint8_t writeBuffer[2];
+    const uint8_t readRegister[1] = { REGISTER_INPUT };
+    uint8_t readBuffer[1];
+    PeripheralIO::tTransaction writeTransaction;
+    PeripheralIO::tTransaction readTransaction;
+
+    void initialiseTransaction(PeripheralIO::tTransaction &transaction, const uint8_t *txBuffer, size_t txCount, uint8_t *rxBuffer, size_t rxCount) {
+      transaction.bus = PeripheralIO::BUS_I2C;
+      transaction.device = Address;
+      transaction.txBuffer = txBuffer;
+      transaction.txCount = txCount;
+      transaction.rxBuffer = rxBuffer;
+      transaction.rxCount = rxCount;
+      transaction.callback = 0;
+      transaction.context = 0;
+      transaction.status = PeripheralIO::STATUS_IDLE;
+    }
+
+    /******************************************************************
+     * @brief Submit the most recently commanded relay states if they
+     * have not yet been queued and the write transaction is free.
+     */
+    void writeMaybe() {
+      if ((this->writePending) && (!PeripheralBus.isBusy(this->writeTransaction))) {
+        this->writeBuffer[0] = REGISTER_OUTPUT;
+        this->writeBuffer[1] = this->status;
+        if (PeripheralBus.submit(this->writeTransaction)) this->writePending = false;
+      }
+    }
+
+    void writeRegister(uint8_t reg, uint8_t value) {
+      Wire.beginTransmission(Address);
+      Wire.write(reg);
+      Wire.write(value);
+      Wire.endTransmission();
+    }
+};
+
+#endif
@@ -0,0 +1,86 @@
+/**
+ * @file MIKROE5981Card.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief MikroBus card driver for the MikroE 5981 Digi Isolator 2 Click.
+ * @version 0.1
+ * @date 2024-08-05
+ * @copyright Copyright (c) 2024
+ *
+ * The card presents the states of its isolated inputs as an SPI frame
+ * which is read through PeripheralIO, so poll() never blocks loop().
+ */
+
+#ifndef MIKROE5981CARD_H
+#define MIKROE5981CARD_H
+
+#include <SPI.h>
+#include "PeripheralIO.h"
+#include "MikroBus.h"
+#include "MIKROE5981Frame.h"
+
+/**********************************************************************
+ * @brief Switch input card driver.
+ *
+ * The card's input channels are read every Interval milliseconds and
+ * Callback is invoked with the current channel states when the read
+ * completes.
+ *
+ * The frame is decoded by MIKROE5981Frame::channels(), which documents
+ * its layout.
+ *
+ * @tparam Socket - the MikroBusSocket hosting the card.
+ * @tparam Callback - function to be called with channel states.
+ * @tparam Interval - polling interval in milliseconds.
+ */
+template <class Socket, void (*Callback)(uint32_t), unsigned long Interval>
+class MIKROE5981Card : public MikroBusCard<MIKROE5981Card<Socket, Callback, Interval>, Socket> {
+  public:
+    static const unsigned int CHANNEL_COUNT = MIKROE5981Frame::CHANNEL_COUNT;
+    static const tMikroBusSpiUsage SPI_USAGE = MIKROBUS_SPI_SHARED;
+
+    MIKROE5981Card() : polledAt(0) {
+      this->transaction.bus = PeripheralIO::BUS_SPI;
+      this->transaction.device = Socket::CS;
+      this->transaction.settings = SPISettings(SPI_CLOCK, MSBFIRST, SPI_MODE0);
+      this->transaction.txBuffer = 0;
+      this->transaction.txCount = FRAME_SIZE;
+      this->transaction.rxBuffer = this->frame;
+      this->transaction.rxCount = FRAME_SIZE;
+      this->transaction.callback = 0;
+      this->transaction.context = 0;
+      this->transaction.status = PeripheralIO::STATUS_IDLE;
+    }
+
+    void onBegin() {
+      pinMode(Socket::CS, OUTPUT);
+      digitalWrite(Socket::CS, HIGH);
+      pinMode(Socket::EN, OUTPUT);
+      digitalWrite(Socket::EN, HIGH);
+      pinMode(Socket::RST, OUTPUT);
+      digitalWrite(Socket::RST, HIGH);
+      SPI.begin();
+    }
+
+    void onPoll() {
+      unsigned long now = millis();
+
+      if (this->transaction.status == PeripheralIO::STATUS_DONE) {
+        this->transaction.status = PeripheralIO::STATUS_IDLE;
+        Callback(MIKROE5981Frame::channels(this->frame));
+      }
+      if (((now - this->polledAt) >= Interval) && (!PeripheralBus.isBusy(this->transaction))) {
+        this->polledAt = now;
+        PeripheralBus.submit(this->transaction);
+      }
+    }
+
+  private:
+    static const uint32_t SPI_CLOCK = 1000000;
+    static const size_t FRAME_SIZE = MIKROE5981Frame::SIZE;
+
+    unsigned long polledAt;
+    uint8_t frame[FRAME_SIZE];
+    PeripheralIO::tTransaction transaction;
+};
+
+#endif
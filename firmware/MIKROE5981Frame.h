@@ -0,0 +1,41 @@
+/**
+ * @file MIKROE5981Frame.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Decoding of the SPI frame read from a MikroE 5981 Digi
+ * Isolator 2 Click.
+ * @version 0.1
+ * @date 2024-08-05
+ * @copyright Copyright (c) 2024
+ *
+ * The card shifts out a frame of SIZE bytes, most significant bit
+ * first, in SPI mode 0. Byte STATUS_BYTE carries the states of the
+ * eight isolated inputs, IN1 in bit 0 through IN8 in bit 7, a set bit
+ * meaning that the input is energised. The other byte carries no
+ * channel state and is ignored.
+ *
+ * The decoder has no hardware dependencies so that it can be checked
+ * on the build host (see host/MIKROE5981FrameTest.cpp).
+ */
+
+#ifndef MIKROE5981FRAME_H
+#define MIKROE5981FRAME_H
+
+namespace MIKROE5981Frame {
+
+  static const size_t SIZE = 2;
+  static const unsigned int STATUS_BYTE = 0;
+  static const unsigned int CHANNEL_COUNT = 8;
+
+  /********************************************************************
+   * @brief Decode a frame.
+   *
+   * @param frame - SIZE bytes in the order they were received.
+   * @return bitmap of channel states, bit 0 being channel 1.
+   */
+  inline uint32_t channels(const uint8_t *frame) {
+    return((uint32_t) frame[STATUS_BYTE]);
+  }
+
+}
+
+#endif
@@ -0,0 +1,152 @@
+/**
+ * @file MIKROE922Card.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief MikroBus card driver for the MikroE 922 ADC Click.
+ * @version 0.1
+ * @date 2024-08-26
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef MIKROE922CARD_H
+#define MIKROE922CARD_H
+
+#include <SPI.h>
+#include <EventResponder.h>
+#include "MikroBus.h"
+
+/**********************************************************************
+ * @brief Continuous sampling driver for the MCP3204 4-channel 12-bit
+ * ADC on the ADC Click.
+ *
+ * Acquisition runs entirely in interrupt context. A hardware interval
+ * timer starts a scan every 1/SampleRate seconds and each channel
+ * conversion is a three byte SPI transfer made by DMA, the completion
+ * interrupt of one transfer starting the next. Samples are written as
+ * Q15 values into one of two blocks of BlockSize scans; when a block
+ * fills the blocks are swapped and onPoll() passes the full block to
+ * Callback, so loop() sees only whole blocks and never waits on the
+ * converter.
+ *
+ * If loop() fails to collect a block before the next one fills the
+ * newer block is discarded and counted as an overrun; a timer tick
+ * which arrives while a scan is still in progress is likewise skipped
+ * and counted.
+ *
+ * The card takes exclusive use of the SPI bus from interrupt context
+ * and so declares MIKROBUS_SPI_EXCLUSIVE: MikroBusSockets refuses to
+ * compile a build which binds another SPI card alongside it.
+ *
+ * @tparam Socket - the MikroBusSocket hosting the card.
+ * @tparam Channels - the number of channels to scan (1 through 4).
+ * @tparam SampleRate - scans per second.
+ * @tparam BlockSize - scans per block passed to Callback.
+ * @tparam Callback - function to be called with each block of samples,
+ * laid out as BlockSize consecutive scans of Channels samples.
+ */
+template <class Socket, unsigned int Channels, unsigned long SampleRate, unsigned int BlockSize, void (*Callback)(const int16_t *samples, unsigned int scans)>
+class MIKROE922Card : public MikroBusCard<MIKROE922Card<Socket, Channels, SampleRate, BlockSize, Callback>, Socket> {
+  public:
+    static const unsigned int CHANNEL_COUNT = 4;
+    static const uint32_t SPI_CLOCK = 1000000;
+    static const tMikroBusSpiUsage SPI_USAGE = MIKROBUS_SPI_EXCLUSIVE;
+
+    static_assert((Channels > 0) && (Channels <= CHANNEL_COUNT), "MIKROE922Card supports between 1 and 4 channels");
+    static_assert((SampleRate * Channels) <= 10000, "MIKROE922Card conversion rate too high for SPI_CLOCK");
+
+    MIKROE922Card() : settings(SPI_CLOCK, MSBFIRST, SPI_MODE0), channel(0), scan(0), filling(0), ready(-1), scanning(false), overruns(0), skipped(0) {
+      for (unsigned int c = 0; c < Channels; c++) {
+        this->commands[c][0] = 0x06;                // Start bit, single-ended
+        this->commands[c][1] = (uint8_t) (c << 6);
+        this->commands[c][2] = 0x00;
+      }
+    }
+
+    void onBegin() {
+      instance = this;
+      pinMode(Socket::CS, OUTPUT);
+      digitalWrite(Socket::CS, HIGH);
+      SPI.begin();
+      this->event.attachImmediate(&transferComplete);
+      this->timer.begin(&startScan, (1000000UL / SampleRate));
+    }
+
+    void onPoll() {
+      int block = this->ready;
+
+      if (block >= 0) {
+        Callback(&this->blocks[block][0][0], BlockSize);
+        this->ready = -1;
+      }
+    }
+
+    unsigned long getOverruns() { return(this->overruns); }
+    unsigned long getSkippedScans() { return(this->skipped); }
+
+  private:
+    static MIKROE922Card *instance;
+
+    SPISettings settings;
+    IntervalTimer timer;
+    EventResponder event;
+    uint8_t commands[Channels][3];
+    alignas(32) uint8_t response[32];        // Whole cache line: DMA receive invalidates it
+    int16_t blocks[2][BlockSize][Channels];
+    unsigned int channel;
+    unsigned int scan;
+    unsigned int filling;
+    volatile int ready;
+    volatile bool scanning;
+    volatile unsigned long overruns;
+    volatile unsigned long skipped;
+
+    void startConversion() {
+      digitalWriteFast(Socket::CS, LOW);
+      SPI.transfer(this->commands[this->channel], this->response, 3, this->event);
+    }
+
+    /******************************************************************
+     * @brief Interval timer handler which starts a scan.
+     */
+    static void startScan() {
+      MIKROE922Card *card = instance;
+
+      if (card->scanning) {
+        card->skipped++;
+        return;
+      }
+      card->scanning = true;
+      card->channel = 0;
+      SPI.beginTransaction(card->settings);
+      card->startConversion();
+    }
+
+    /******************************************************************
+     * @brief DMA completion handler which saves a conversion result
+     * and starts the next conversion or finishes the scan.
+     */
+    static void transferComplete(EventResponder &event) {
+      MIKROE922Card *card = instance;
+
+      digitalWriteFast(Socket::CS, HIGH);
+      card->blocks[card->filling][card->scan][card->channel] = (int16_t) ((((card->response[1] & 0x0f) << 8) | card->response[2]) << 3);
+      if (++card->channel < Channels) {
+        card->startConversion();
+        return;
+      }
+      SPI.endTransaction();
+      card->scanning = false;
+      if (++card->scan < BlockSize) return;
+      card->scan = 0;
+      if (card->ready >= 0) {
+        card->overruns++;
+        return;
+      }
+      card->ready = card->filling;
+      card->filling ^= 1;
+    }
+};
+
+template <class Socket, unsigned int Channels, unsigned long SampleRate, unsigned int BlockSize, void (*Callback)(const int16_t *, unsigned int)>
+MIKROE922Card<Socket, Channels, SampleRate, BlockSize, Callback> *MIKROE922Card<Socket, Channels, SampleRate, BlockSize, Callback>::instance = 0;
+
+#endif
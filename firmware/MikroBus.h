@@ -0,0 +1,126 @@
+/**
+ * @file MikroBus.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Compile-time binding of Click card drivers to MikroBus sockets.
+ * @version 0.1
+ * @date 2024-08-05
+ * @copyright Copyright (c) 2024
+ *
+ * Each of NOP100's two MikroBus sockets is bound at compile time to a
+ * card driver derived from MikroBusCard. The driver receives its
+ * socket's pin assignment as a template parameter, so a left socket
+ * and a right socket can host different card types in the same
+ * firmware build.
+ *
+ * MikroBusCard uses the curiously recurring template pattern: the
+ * begin(), poll(), interrupt() and command() hooks are resolved
+ * statically to the derived driver's onBegin(), onPoll(),
+ * onInterrupt() and onCommand() methods, so there are no virtual calls
+ * in loop() and an unused socket (MikroBusEmptyCard) compiles away to
+ * nothing.
+ */
+
+#ifndef MIKROBUS_H
+#define MIKROBUS_H
+
+/**********************************************************************
+ * @brief How a card driver uses the SPI bus.
+ *
+ * A shared card's transfers are queued with other SPI traffic (see
+ * PeripheralIO.h). An exclusive card drives the bus itself from
+ * interrupt context and cannot be built alongside any other SPI card.
+ */
+enum tMikroBusSpiUsage { MIKROBUS_SPI_NONE, MIKROBUS_SPI_SHARED, MIKROBUS_SPI_EXCLUSIVE };
+
+/**********************************************************************
+ * @brief Pin assignment of a MikroBus socket.
+ */
+template <uint8_t cs, uint8_t en, uint8_t intr, uint8_t rst, uint8_t pwm>
+struct MikroBusSocket {
+  static const uint8_t CS = cs;
+  static const uint8_t EN = en;
+  static const uint8_t INT = intr;
+  static const uint8_t RST = rst;
+  static const uint8_t PWM = pwm;
+};
+
+/**********************************************************************
+ * @brief Base class for all Click card drivers.
+ *
+ * A driver hides whichever of the on...() hooks it needs to implement
+ * and sets INTERRUPT_MODE to RISING, FALLING or CHANGE if it wants
+ * onInterrupt() to be called from an interrupt on its socket's INT
+ * pin.
+ *
+ * onCommand() is a general purpose hook through which an application
+ * can pass a value (typically a channel state bitmap) to the card.
+ * The default implementation returns false to signal that the card
+ * accepts no commands.
+ *
+ * A card with input or output channels sets CHANNEL_COUNT, so that an
+ * application can number channels across both sockets; an empty socket
+ * has none. A card which uses the SPI bus sets SPI_USAGE.
+ *
+ * @tparam Driver - the derived driver class.
+ * @tparam Socket - the MikroBusSocket hosting the card.
+ */
+template <class Driver, class Socket>
+class MikroBusCard {
+  public:
+    typedef Socket SocketPins;
+    static const int INTERRUPT_MODE = 0;
+    static const unsigned int CHANNEL_COUNT = 0;
+    static const tMikroBusSpiUsage SPI_USAGE = MIKROBUS_SPI_NONE;
+
+    void begin() { static_cast<Driver*>(this)->onBegin(); }
+    void poll() { static_cast<Driver*>(this)->onPoll(); }
+    void interrupt() { static_cast<Driver*>(this)->onInterrupt(); }
+    bool command(uint32_t value) { return(static_cast<Driver*>(this)->onCommand(value)); }
+
+    void onBegin() {}
+    void onPoll() {}
+    void onInterrupt() {}
+    bool onCommand(uint32_t value) { return(false); }
+};
+
+/**********************************************************************
+ * @brief Driver for an unoccupied socket.
+ */
+template <class Socket>
+class MikroBusEmptyCard : public MikroBusCard<MikroBusEmptyCard<Socket>, Socket> {
+};
+
+/**********************************************************************
+ * @brief Container for the card drivers bound to NOP100's sockets.
+ *
+ * The drivers are static members so that the interrupt trampolines
+ * installed by begin() can reach them without a run-time lookup.
+ *
+ * @tparam Left - driver bound to the left hand socket.
+ * @tparam Right - driver bound to the right hand socket.
+ */
+template <class Left, class Right>
+class MikroBusSockets {
+  static_assert(((Left::SPI_USAGE != MIKROBUS_SPI_EXCLUSIVE) || (Right::SPI_USAGE == MIKROBUS_SPI_NONE)) && ((Right::SPI_USAGE != MIKROBUS_SPI_EXCLUSIVE) || (Left::SPI_USAGE == MIKROBUS_SPI_NONE)), "A card which takes exclusive use of the SPI bus cannot share a build with another SPI card");
+
+  public:
+    static Left left;
+    static Right right;
+
+    static void begin() {
+      left.begin();
+      right.begin();
+      if (Left::INTERRUPT_MODE) attachInterrupt(digitalPinToInterrupt(Left::SocketPins::INT), [](){ left.interrupt(); }, Left::INTERRUPT_MODE);
+      if (Right::INTERRUPT_MODE) attachInterrupt(digitalPinToInterrupt(Right::SocketPins::INT), [](){ right.interrupt(); }, Right::INTERRUPT_MODE);
+    }
+
+    static void poll() {
+      left.poll();
+      right.poll();
+    }
+};
+
+template <class Left, class Right> Left MikroBusSockets<Left, Right>::left;
+template <class Left, class Right> Right MikroBusSockets<Left, Right>::right;
+
+#endif
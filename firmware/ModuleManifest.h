@@ -0,0 +1,185 @@
+/**
+ * @file ModuleManifest.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Types and compile-time checks for module manifests.
+ * @version 0.1
+ * @date 2024-09-16
+ * @copyright Copyright (c) 2024
+ *
+ * Each specialisation describes itself in a manifest.h which defines
+ * the following constexpr tables in namespace ModuleManifest:
+ *
+ * TransmittedPGNs - the PGNs the module transmits, terminated by 0.
+ *
+ * ReceivedPGNs - the PGNs the module handles and their handlers,
+ * terminated by { 0L, 0 }.
+ *
+ * Configuration - one entry for each byte of the module configuration
+ * giving its default value and the inclusive range of values it may
+ * take. A block at the end of the configuration which belongs to
+ * LocalLogic is validated by the engine and is omitted. The size of
+ * the module configuration is derived from this table.
+ *
+ * Schedulers - periodic transmissions, each given as the configuration
+ * indices of its period and offset, the units of each in milliseconds
+ * and the function which transmits, terminated by { 0, 0, 0, 0, 0 }.
+ *
+ * Subscribers - functions to be told of changes to a range of
+ * configuration indices (see ConfigurationObserver.h), each given as
+ * the first and last index of the range and the handler, terminated by
+ * { 0, 0, 0 }.
+ *
+ * NOP100 builds its transmit PGN list, message dispatch table, default
+ * configuration, configuration validation, transmit schedulers and
+ * configuration subscriptions from these tables, so they are constant
+ * data with no initialisation code, and static_assert()s reject a
+ * manifest which is inconsistent.
+ */
+
+#ifndef MODULEMANIFEST_H
+#define MODULEMANIFEST_H
+
+typedef struct {
+  unsigned long PGN;
+  void (*handler)(const tN2kMsg &N2kMsg);
+} tManifestReceivedPGN;
+
+typedef struct {
+  unsigned char defaultValue;
+  unsigned char minimum;
+  unsigned char maximum;
+} tManifestConfigurationByte;
+
+typedef struct {
+  unsigned int periodIndex;
+  unsigned long periodUnit;
+  unsigned int offsetIndex;
+  unsigned long offsetUnit;
+  void (*transmit)();
+} tManifestScheduler;
+
+typedef struct {
+  unsigned int first;
+  unsigned int last;
+  void (*handler)(unsigned int index, unsigned char value);
+} tManifestSubscriber;
+
+template <unsigned int Size>
+struct tManifestDefaults {
+  unsigned char bytes[Size];
+};
+
+/**********************************************************************
+ * @brief Build a default configuration from a manifest.
+ *
+ * Bytes beyond the end of the manifest default to zero.
+ */
+template <unsigned int Size, unsigned int Count>
+constexpr tManifestDefaults<Size> manifestDefaults(const tManifestConfigurationByte (&configuration)[Count]) {
+  tManifestDefaults<Size> defaults = {};
+
+  for (unsigned int i = 0; i < Count; i++) defaults.bytes[i] = configuration[i].defaultValue;
+  return(defaults);
+}
+
+/**********************************************************************
+ * @brief Check that every default value lies within its range.
+ */
+template <unsigned int Count>
+constexpr bool manifestDefaultsInRange(const tManifestConfigurationByte (&configuration)[Count]) {
+  for (unsigned int i = 0; i < Count; i++) {
+    if ((configuration[i].defaultValue < configuration[i].minimum) || (configuration[i].defaultValue > configuration[i].maximum)) return(false);
+  }
+  return(true);
+}
+
+/**********************************************************************
+ * @brief Check that a PGN list is terminated and free of duplicates.
+ */
+template <unsigned int Count>
+constexpr bool manifestPGNsValid(const unsigned long (&pgns)[Count]) {
+  if (pgns[Count - 1] != 0) return(false);
+  for (unsigned int i = 0; i < (Count - 1); i++) {
+    if (pgns[i] == 0) return(false);
+    for (unsigned int j = (i + 1); j < (Count - 1); j++) if (pgns[i] == pgns[j]) return(false);
+  }
+  return(true);
+}
+
+/**********************************************************************
+ * @brief Check that a dispatch table is terminated, free of duplicates
+ * and has a handler for every PGN.
+ */
+template <unsigned int Count>
+constexpr bool manifestHandlersValid(const tManifestReceivedPGN (&handlers)[Count]) {
+  if (handlers[Count - 1].PGN != 0) return(false);
+  for (unsigned int i = 0; i < (Count - 1); i++) {
+    if ((handlers[i].PGN == 0) || (handlers[i].handler == 0)) return(false);
+    for (unsigned int j = (i + 1); j < (Count - 1); j++) if (handlers[i].PGN == handlers[j].PGN) return(false);
+  }
+  return(true);
+}
+
+/**********************************************************************
+ * @brief Check whether a dispatch table handles a PGN.
+ */
+template <unsigned int Count>
+constexpr bool manifestReceives(const tManifestReceivedPGN (&handlers)[Count], unsigned long PGN) {
+  for (unsigned int i = 0; i < (Count - 1); i++) if (handlers[i].PGN == PGN) return(true);
+  return(false);
+}
+
+/**********************************************************************
+ * @brief Get the number of configuration bytes described.
+ */
+template <unsigned int Count>
+constexpr unsigned int manifestConfigurationCount(const tManifestConfigurationByte (&configuration)[Count]) {
+  return(Count);
+}
+
+/**********************************************************************
+ * @brief Get the number of schedulers, excluding the terminator.
+ */
+template <unsigned int Count>
+constexpr unsigned int manifestSchedulerCount(const tManifestScheduler (&schedulers)[Count]) {
+  return(Count - 1);
+}
+
+/**********************************************************************
+ * @brief Check that schedulers are terminated, have a transmit
+ * function and refer to configuration bytes described by the
+ * manifest.
+ */
+template <unsigned int Count>
+constexpr bool manifestSchedulersValid(const tManifestScheduler (&schedulers)[Count], unsigned int configurationCount) {
+  if (schedulers[Count - 1].transmit != 0) return(false);
+  for (unsigned int i = 0; i < (Count - 1); i++) {
+    if ((schedulers[i].transmit == 0) || (schedulers[i].periodUnit == 0)) return(false);
+    if ((schedulers[i].periodIndex >= configurationCount) || (schedulers[i].offsetIndex >= configurationCount)) return(false);
+  }
+  return(true);
+}
+
+/**********************************************************************
+ * @brief Get the number of subscribers, excluding the terminator.
+ */
+template <unsigned int Count>
+constexpr unsigned int manifestSubscriberCount(const tManifestSubscriber (&subscribers)[Count]) {
+  return(Count - 1);
+}
+
+/**********************************************************************
+ * @brief Check that subscribers are terminated, have a handler and
+ * subscribe to a non-empty range of configuration bytes described by
+ * the manifest.
+ */
+template <unsigned int Count>
+constexpr bool manifestSubscribersValid(const tManifestSubscriber (&subscribers)[Count], unsigned int configurationCount) {
+  if (subscribers[Count - 1].handler != 0) return(false);
+  for (unsigned int i = 0; i < (Count - 1); i++) {
+    if ((subscribers[i].handler == 0) || (subscribers[i].first > subscribers[i].last) || (subscribers[i].last >= configurationCount)) return(false);
+  }
+  return(true);
+}
+
+#endif
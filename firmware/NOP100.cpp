@@ -39,8 +39,30 @@
 #include <ModuleConfiguration.h>
 #include <FunctionMapper.h>
 #include <arraymacros.h>
+#include "MikroBus.h"
+#include "LocalLogic.h"
+#include "ConfigurationObserver.h"
+#include "BusLoad.h"
+#include "ModuleManifest.h"
 
-#include "includes.h"
+/**********************************************************************
+ * @brief Select the module specialisation to be built.
+ *
+ * If NOP100_MODULE is defined as a build flag (for example
+ * -DNOP100_MODULE=NOP100-ROM) the specialisation files are taken from
+ * modules/NOP100_MODULE/ so that any number of variants can be built
+ * from one tree. Otherwise the files linked into this folder by
+ * link-module are used.
+ */
+#define NOP100_STRINGIFY_(x) #x
+#define NOP100_STRINGIFY(x) NOP100_STRINGIFY_(x)
+#ifdef NOP100_MODULE
+#define MODULE_FILE(file) NOP100_STRINGIFY(modules/NOP100_MODULE/file)
+#else
+#define MODULE_FILE(file) NOP100_STRINGIFY(file)
+#endif
+
+#include MODULE_FILE(includes.h)
 
 /**********************************************************************
  * @brief Configure debug output to Teensy serial port.
@@ -102,11 +124,17 @@
 #define GPIO_CAN_TX GPIO_D22
 #define GPIO_CAN_RX GPIO_D23
 
+/**********************************************************************
+ * @brief Pin assignments of the left and right MikroBus sockets.
+ */
+typedef MikroBusSocket<GPIO_MIKROBUS_MODULE0_CS, GPIO_MIKROBUS_MODULE0_EN, GPIO_MIKROBUS_MODULE0_INT, GPIO_MIKROBUS_RST, GPIO_MIKROBUS_MODULE0_PWM> MikroBusSocketLeft;
+typedef MikroBusSocket<GPIO_MIKROBUS_MODULE1_CS, GPIO_MIKROBUS_MODULE1_EN, GPIO_MIKROBUS_MODULE1_INT, GPIO_MIKROBUS_RST, GPIO_MIKROBUS_MODULE1_PWM> MikroBusSocketRight;
+
 /**********************************************************************
  * @brief NMEA2000 device information.
  * 
- * Most specialisations of NOP100 will want to override DEVICE_CLASS,
- * DEVICE_FUNCTION and perhaps DEVICE_UNIQUE_NUMBER.
+ * Most specialisations of NOP100 will want to override DEVICE_CLASS and
+ * DEVICE_FUNCTION.
  * 
  * DEVICE_CLASS and DEVICE_FUNCTION are explained in the document
  * "NMEA 2000 Appendix B.6 Class & Function Codes".
@@ -117,13 +145,19 @@
  * members so we grub around and use 2046 which is currently not
  * allocated.  
  * 
- * DEVICE_UNIQUE_NUMBER is a bit of mystery.
+ * DEVICE_UNIQUE_NUMBER is the 21-bit unique number in the device's
+ * NAME. Devices which share a manufacturer code, class and function
+ * must have different unique numbers or they contend for one address
+ * on every cold start. Zero, the default, takes the number from the
+ * low 21 bits of the serial number which PJRC programs into the
+ * Teensy's OTP fuses, so that every board is distinct; a non-zero
+ * value is used as given.
  */
 #define DEVICE_CLASS 10                 // System Tools
 #define DEVICE_FUNCTION 130             // Diagnostic
 #define DEVICE_INDUSTRY_GROUP 4         // Maritime
 #define DEVICE_MANUFACTURER_CODE 2046   // Currently not allocated.
-#define DEVICE_UNIQUE_NUMBER 849        // Bump me?
+#define DEVICE_UNIQUE_NUMBER 0          // From the Teensy serial number
 
 /**********************************************************************
  * @brief NMEA2000 product information.
@@ -144,53 +178,86 @@
  * 
  * PRODUCT_N2K_VERSION is the version of the N2K specification witht
  * which the firmware complies. 
+ *
+ * PRODUCT_SERIAL_CODE is built at startup from PRODUCT_CODE and the
+ * device unique number unless a specialisation defines it.
+ *
+ * PRODUCT_TYPE is reported as the product's model ID.
  */
 #define PRODUCT_CERTIFICATION_LEVEL 0   // Not certified
 #define PRODUCT_CODE 002                // Our own product code
 #define PRODUCT_FIRMWARE_VERSION "1.1.0 (Jun 2022)"
 #define PRODUCT_LEN 1                   // This device's LEN
 #define PRODUCT_N2K_VERSION 2100        // N2K specification version 2.1
-#define PRODUCT_SERIAL_CODE "002-849"   // PRODUCT_CODE + DEVICE_UNIQUE_NUMBER
-#define PRODUCT_TYPE "PDJRSIM"           // The product name?
+#define PRODUCT_TYPE "PDJRSIM"          // Model ID
 #define PRODUCT_VERSION "1.0 (Mar 2022)"
 
 /**********************************************************************
- * @brief NMEA2000 transmit and receive PGNs.
- * 
- * NMEA_TRANSMITTED_PGNS is a zero terminated array initialiser that
- * lists all the PGNs we transmit.
- * 
- * NMEA_RECEIVED_PGNS is a an array initialiser consisting of pairs
- * which associate the PGN of a message we will accept to a callback
- * which will accept a received message. For example,
- * { 127501L, handlerForPgn127501 }. The list must terminate with the
- * special flag value { 0L, 0 }.
+ * @brief NMEA2000 library buffer sizing.
+ *
+ * N2K_CAN_MSG_BUF_SIZE sets the number of fast-packet messages which
+ * the library can assemble concurrently and N2K_CAN_RECEIVE_FRAME_BUF_SIZE
+ * and N2K_CAN_SEND_FRAME_BUF_SIZE set the depth of the CAN driver's
+ * frame queues. Zero leaves the library default in place.
+ *
+ * So that sizes can be chosen on evidence, NOP100 records the largest
+ * number of frames delivered by one ParseMessages() call and queued
+ * for transmission in one pass of loop() and counts messages which
+ * the library refused to queue. The library exposes neither the
+ * occupancy of its frame queues nor frames lost from its receive
+ * queue, so these peaks per pass are lower bounds on occupancy, not
+ * high-water marks, and no receive overflow count is reported.
+ *
+ * The statistics are always collected but are reported only with
+ * DEBUG_SERIAL, together with the high-water marks and overflow counts
+ * of NOP100's own queues, every BUFFER_STATISTICS_REPORT_INTERVAL
+ * milliseconds. Release builds have no reporting channel for them.
  */
-#define NMEA_TRANSMITTED_PGNS { 0L }
-#define NMEA_RECEIVED_PGNS  { { 0L, 0 } }
+#define N2K_CAN_MSG_BUF_SIZE 0
+#define N2K_CAN_RECEIVE_FRAME_BUF_SIZE 0
+#define N2K_CAN_SEND_FRAME_BUF_SIZE 0
+#define BUFFER_STATISTICS_REPORT_INTERVAL 60000UL
+
+/**********************************************************************
+ * @brief Bus load estimation and adaptive transmission rate.
+ *
+ * NOP100 estimates bus utilisation from the frames it receives and
+ * transmits, assuming a mean frame length of BUS_LOAD_BITS_PER_FRAME
+ * bits (an 8-byte extended frame with typical bit stuffing). Each
+ * BUS_LOAD_SAMPLE_INTERVAL milliseconds the estimate is updated and,
+ * once it exceeds BUS_LOAD_THRESHOLD percent, periodic transmissions
+ * are stretched by up to BUS_LOAD_MAXIMUM_STRETCH times their
+ * configured period. Whenever the stretch factor changes NOP100
+ * reschedules the manifest schedulers and calls onBusLoadChange().
+ */
+#define BUS_LOAD_BIT_RATE 250000UL
+#define BUS_LOAD_BITS_PER_FRAME 140
+#define BUS_LOAD_SAMPLE_INTERVAL 1000UL
+#define BUS_LOAD_THRESHOLD 50
+#define BUS_LOAD_MAXIMUM_STRETCH 4
 
 /**********************************************************************
  * @brief ModuleConfiguration library stuff.
+ *
+ * MODULE_CONFIGURATION_SIZE is not set here: it is derived from the
+ * manifest once that has been included.
  */
-#define MODULE_CONFIGURATION_SIZE 1
 #define MODULE_CONFIGURATION_EEPROM_STORAGE_ADDRESS 0
 
 #define MODULE_CONFIGURATION_CAN_SOURCE_INDEX 0
 #define MODULE_CONFIGURATION_CAN_SOURCE_DEFAULT 22
-
-#define MODULE_CONFIGURATION_DEFAULT { \
-  MODULE_CONFIGURATION_CAN_SOURCE_DEFAULT \
-}
+#define MODULE_CONFIGURATION_CAN_SOURCE_MANIFEST { MODULE_CONFIGURATION_CAN_SOURCE_DEFAULT, 0, 255 }
 
 /**********************************************************************
  * @brief FunctionMapper library stuff.
  * 
  * This provides just one function that wipes configuration data from
- * EEPROM. A specialisation of NOP100 that needs to add functions to
+ * EEPROM and, since erasing restores the defaults without validation,
+ * records every index as changed. A specialisation of NOP100 that needs to add functions to
  * the function mapper will need to increase FUNCTION_MAPPER_SIZE
  * appropriately.
  */
-#define FUNCTION_MAP_ARRAY { { 255, [](unsigned char i, unsigned char v) -> bool { ModuleConfiguration.erase(); return(true); } }, { 0, 0 } };
+#define FUNCTION_MAP_ARRAY { { 255, [](unsigned char i, unsigned char v) -> bool { ModuleConfiguration.erase(); ConfigurationChanges.recordAll(); return(true); } }, { 0, 0 } };
 #define FUNCTION_MAPPER_SIZE 0
 
 /**********************************************************************
@@ -208,42 +275,181 @@
 #define CAN_LED_UPDATE_INTERVAL 100UL
 #define PRG_LED_UPDATE_INTERVAL 100UL
 
-#include "defines.h"
+/**********************************************************************
+ * @brief Timer-driven operator interface.
+ *
+ * By default the LEDs are updated and the PRG button is polled on
+ * every pass of loop(). Defining OPERATOR_INTERFACE_TIMER_DRIVEN in
+ * defines.h moves this work onto a hardware IntervalTimer which ticks
+ * every OPERATOR_INTERFACE_TIMER_TICK microseconds: the PRG button is
+ * sampled and debounced there, a change of state being accepted once
+ * it has persisted for PRG_BUTTON_DEBOUNCE_TICKS ticks and posted to
+ * loop() as an event.
+ *
+ * LedManager makes no promise of interrupt safety, so in this mode the
+ * LEDs are TimerLed objects instead. They accept the same calls, but a
+ * call only posts a pattern request to a queue of LED_REQUEST_QUEUE_SIZE
+ * entries; the timer owns the pattern state and drives the GPIO, so a
+ * slow pass of loop() neither delays nor stretches a flash.
+ */
+#define OPERATOR_INTERFACE_TIMER_TICK 5000UL
+#define PRG_BUTTON_DEBOUNCE_TICKS 4
+#define PRG_BUTTON_EVENT_QUEUE_SIZE 8
+#define LED_REQUEST_QUEUE_SIZE 4
+
+/**********************************************************************
+ * @brief MikroBus card bindings.
+ *
+ * A specialisation which uses the card drivers in MikroBus.h binds a
+ * driver to a socket by overriding MIKROBUS_SOCKET_LEFT_CARD and/or
+ * MIKROBUS_SOCKET_RIGHT_CARD. For example:
+ *
+ * #define MIKROBUS_SOCKET_RIGHT_CARD MIKROE5675Card<MikroBusSocketRight, 0x71, relayCallback, 100>
+ *
+ * Unbound sockets are left empty and cost nothing.
+ */
+#define MIKROBUS_SOCKET_LEFT_CARD MikroBusEmptyCard<MikroBusSocketLeft>
+#define MIKROBUS_SOCKET_RIGHT_CARD MikroBusEmptyCard<MikroBusSocketRight>
+
+/**********************************************************************
+ * @brief LocalLogic stuff.
+ *
+ * A specialisation enables the local logic engine by overriding
+ * LOCAL_LOGIC_RULE_COUNT and LOCAL_LOGIC_LOCAL_CHANNEL_COUNT, reserving
+ * LOCAL_LOGIC_CONFIGURATION_SIZE bytes of module configuration at
+ * LOCAL_LOGIC_CONFIGURATION_INDEX and defining the output handler
+ * localLogicOutputHandler(unsigned int channel, bool state).
+ *
+ * LOCAL_LOGIC_REMOTE_BANK_COUNT sets the number of remote switchbanks
+ * which can be mirrored from received PGN 127501 messages. A
+ * specialisation which mirrors any must list PGN 127501 in its
+ * manifest's ReceivedPGNs with handleLocalLogicPGN127501() as the
+ * handler, or call that function from its own handler.
+ */
+#define LOCAL_LOGIC_RULE_COUNT 0
+#define LOCAL_LOGIC_REMOTE_BANK_COUNT 0
+#define LOCAL_LOGIC_LOCAL_CHANNEL_COUNT 0
+#define LOCAL_LOGIC_CONFIGURATION_INDEX 0
+#define LOCAL_LOGIC_CONFIGURATION_SIZE (LOCAL_LOGIC_REMOTE_BANK_COUNT + (LOCAL_LOGIC_RULE_COUNT * 5))
+
+#include MODULE_FILE(defines.h)
+
+#ifdef MODULE_CONFIGURATION_SIZE
+#error "MODULE_CONFIGURATION_SIZE is derived from the manifest and must not be defined"
+#endif
 
 /**
  * @brief Declarations of local functions.
  */
 void messageHandler(const tN2kMsg&);
+void onPowerUp();
 void onN2kOpen();
 bool configurationValidator(unsigned int index, unsigned char value);
+bool validateConfiguration(unsigned int index, unsigned char value);
+void handlePRGButtonEvent(bool state);
+bool transmitMessage(const tN2kMsg &N2kMsg);
+unsigned long deviceUniqueNumber();
+void reportBufferStatisticsMaybe();
+void onBusLoadChange();
+void handleN2kOpen();
+void configureModuleSchedulers();
+void handleLocalLogicPGN127501(const tN2kMsg &N2kMsg);
 
 /**
- * @brief Create and initialise an array of transmitted PGNs.
- * 
- * Array initialiser is specified in defined.h. Required by NMEA2000
- * library. 
+ * @brief The specialisation's manifest: the PGNs it transmits and
+ * receives, its configuration defaults and ranges and its periodic
+ * transmissions.
  */
-const unsigned long TransmitMessages[] = NMEA_TRANSMITTED_PGNS;
+#include MODULE_FILE(manifest.h)
 
 /**
- * @brief Create and initialise a vector of received PGNs and their
- *        handlers.
- * 
- * Array initialiser is specified in defined.h. Required by NMEA2000
- * library. 
+ * @brief Size of the module configuration: the bytes described by the
+ * manifest followed by any LocalLogic block.
+ */
+#define MODULE_CONFIGURATION_SIZE (manifestConfigurationCount(ModuleManifest::Configuration) + LOCAL_LOGIC_CONFIGURATION_SIZE)
+
+static_assert(manifestPGNsValid(ModuleManifest::TransmittedPGNs), "Manifest TransmittedPGNs must be zero terminated and free of duplicates");
+static_assert(manifestHandlersValid(ModuleManifest::ReceivedPGNs), "Manifest ReceivedPGNs must be terminated, free of duplicates and have a handler for every PGN");
+static_assert(manifestDefaultsInRange(ModuleManifest::Configuration), "Manifest Configuration has a default value outside its range");
+#if LOCAL_LOGIC_RULE_COUNT > 0
+static_assert(LOCAL_LOGIC_CONFIGURATION_INDEX == manifestConfigurationCount(ModuleManifest::Configuration), "LocalLogic configuration block must follow the bytes described by the manifest");
+#endif
+#if (LOCAL_LOGIC_RULE_COUNT > 0) && (LOCAL_LOGIC_REMOTE_BANK_COUNT > 0)
+static_assert(manifestReceives(ModuleManifest::ReceivedPGNs, 127501L), "Manifest ReceivedPGNs must handle PGN 127501 for LocalLogic to mirror remote switchbanks");
+#endif
+static_assert(manifestSchedulersValid(ModuleManifest::Schedulers, manifestConfigurationCount(ModuleManifest::Configuration)), "Manifest Schedulers must be terminated, have a transmit function and refer to described configuration bytes");
+static_assert(manifestSubscribersValid(ModuleManifest::Subscribers, manifestConfigurationCount(ModuleManifest::Configuration)), "Manifest Subscribers must be terminated, have a handler and refer to described configuration bytes");
+
+/**
+ * @brief High-water mark and overflow count of a buffer or queue.
+ *
+ * A size of zero means the library default. countsOverflows is false
+ * for a buffer whose overflows cannot be observed. measuresOccupancy
+ * is false for a library queue, whose occupancy cannot be observed and
+ * for which highWaterMark holds the largest number of frames passed in
+ * one pass of loop().
+ */
+typedef struct {
+  const char *name;
+  unsigned int size;
+  bool countsOverflows;
+  bool measuresOccupancy;
+  volatile unsigned int highWaterMark;
+  volatile unsigned long overflows;
+} tBufferStatistics;
+
+tBufferStatistics N2kReceiveStatistics = { "N2K RX frames", N2K_CAN_RECEIVE_FRAME_BUF_SIZE, false, false, 0, 0 };
+tBufferStatistics N2kTransmitStatistics = { "N2K TX frames", N2K_CAN_SEND_FRAME_BUF_SIZE, true, false, 0, 0 };
+unsigned int N2kReceiveFrames = 0;
+unsigned int N2kTransmitFrames = 0;
+
+void recordBufferLevel(tBufferStatistics &statistics, unsigned int level) {
+  if (level > statistics.highWaterMark) statistics.highWaterMark = level;
+}
+
+/**
+ * @brief Create a monitor which estimates bus load and the factor by
+ * which periodic transmissions should be stretched.
  */
-typedef struct { unsigned long PGN; void (*Handler)(const tN2kMsg &N2kMsg); } tNMEA2000Handler;
-tNMEA2000Handler NMEA2000Handlers[] = NMEA_RECEIVED_PGNS;
+BusLoadMonitor<BUS_LOAD_BIT_RATE, BUS_LOAD_BITS_PER_FRAME, BUS_LOAD_SAMPLE_INTERVAL, BUS_LOAD_THRESHOLD, BUS_LOAD_MAXIMUM_STRETCH> BusLoad;
 
 /**
  * @brief Create a ModuleConfiguration object for managing all module
  *        configuration data.
  * 
  * ModuleConfiguration implements the ModuleOperatorInterfaceHandler interface
- * and can be managed by the user-interaction manager.
+ * and can be managed by the user-interaction manager. The default
+ * configuration is computed from the manifest at compile time and is
+ * kept in flash. The library's constructor is declared with a
+ * non-const pointer, but it only reads the defaults.
 */
-unsigned char defaultConfiguration[] = MODULE_CONFIGURATION_DEFAULT;
-ModuleConfiguration ModuleConfiguration(defaultConfiguration, MODULE_CONFIGURATION_SIZE, MODULE_CONFIGURATION_EEPROM_STORAGE_ADDRESS, configurationValidator);
+constexpr tManifestDefaults<MODULE_CONFIGURATION_SIZE> DefaultConfiguration PROGMEM = manifestDefaults<MODULE_CONFIGURATION_SIZE>(ModuleManifest::Configuration);
+ModuleConfiguration ModuleConfiguration(const_cast<unsigned char *>(DefaultConfiguration.bytes), MODULE_CONFIGURATION_SIZE, MODULE_CONFIGURATION_EEPROM_STORAGE_ADDRESS, validateConfiguration);
+
+/**
+ * @brief Create a scheduler for each periodic transmission in the
+ *        manifest.
+ */
+tN2kSyncScheduler ModuleSchedulers[sizeof(ModuleManifest::Schedulers) / sizeof(ModuleManifest::Schedulers[0])];
+
+/**
+ * @brief Create an observer which notifies subscribers of changes to
+ * the module configuration.
+ *
+ * The subscription table is sized from the manifest: two entries for
+ * each scheduler, one for local logic and one for each entry in
+ * Subscribers.
+ */
+ConfigurationObserver<MODULE_CONFIGURATION_SIZE, ((2 * manifestSchedulerCount(ModuleManifest::Schedulers)) + ((LOCAL_LOGIC_RULE_COUNT > 0)?1:0) + manifestSubscriberCount(ModuleManifest::Subscribers))> ConfigurationChanges;
+
+#if LOCAL_LOGIC_RULE_COUNT > 0
+/**
+ * @brief Create a local logic engine which evaluates rules held in the
+ *        module configuration.
+ */
+void localLogicOutputHandler(unsigned int channel, bool state);
+LocalLogicEngine<LOCAL_LOGIC_RULE_COUNT, LOCAL_LOGIC_REMOTE_BANK_COUNT, LOCAL_LOGIC_LOCAL_CHANNEL_COUNT> LocalLogic(LOCAL_LOGIC_CONFIGURATION_INDEX, localLogicOutputHandler);
+#endif
 
 /**
  * @brief Create a FunctionHandler object for managing all extended
@@ -274,6 +480,7 @@ Button PRGButton(GPIO_BUTTON_PRG);
  */
 IC74HC165 CodeSwitchPISO (GPIO_PISO_CLOCK, GPIO_PISO_DATA, GPIO_PISO_LATCH);
 
+#ifndef OPERATOR_INTERFACE_TIMER_DRIVEN
 /**
  * @brief tLedManager objects for operating the CAN and PRG LEDs.
  * 
@@ -282,13 +489,166 @@ IC74HC165 CodeSwitchPISO (GPIO_PISO_CLOCK, GPIO_PISO_DATA, GPIO_PISO_LATCH);
  */
 LedManager CanLed([](unsigned int status){ digitalWrite(GPIO_LED_CAN, (status & 0x01)); }, CAN_LED_UPDATE_INTERVAL);
 LedManager PrgLed([](unsigned int status){ digitalWrite(GPIO_LED_PRG, (status & 0x01)); }, PRG_LED_UPDATE_INTERVAL);
+#else
+/**
+ * @brief An LED driven by the operator interface timer.
+ *
+ * setStatus() and setLedState() post a request to a queue with a
+ * single producer (loop()) and a single consumer (the timer), so need
+ * no locking. tick() runs in the timer handler: it takes any requests,
+ * advances the current pattern one step every StepTicks ticks and
+ * writes the GPIO. ONCE, TWICE and THRICE flash over the steady state
+ * set by ON or OFF and then return to it; FLASH repeats until the next
+ * request.
+ *
+ * @tparam Pin - GPIO driving the LED.
+ * @tparam StepTicks - timer ticks per pattern step.
+ */
+template <uint8_t Pin, unsigned int StepTicks>
+class TimerLed {
+  public:
+    TimerLed(const char *name) : statistics({ name, LED_REQUEST_QUEUE_SIZE, true, true, 0, 0 }), head(0), tail(0), level(0), pattern(0), length(0), step(0), repeat(false), ticks(0) {}
+
+    void setStatus(unsigned int status) {
+      this->post((status & 0x01)?LedManager::ON:LedManager::OFF);
+    }
+
+    void setLedState(unsigned int led, LedManager::tLedState state) {
+      if (led == 0) this->post(state);
+    }
+
+    void tick() {
+      bool started = false;
+
+      while (this->tail != this->head) {
+        this->start(this->requests[this->tail]);
+        this->tail = ((this->tail + 1) % LED_REQUEST_QUEUE_SIZE);
+        started = true;
+      }
+      if ((!started) && (this->length > 0) && (++this->ticks >= StepTicks)) {
+        this->ticks = 0;
+        if (++this->step >= this->length) {
+          this->step = 0;
+          if (!this->repeat) this->length = 0;
+        }
+      }
+      digitalWriteFast(Pin, (this->length > 0)?((this->pattern >> this->step) & 0x01):this->level);
+    }
+
+    tBufferStatistics statistics;
+
+  private:
+    volatile uint8_t requests[LED_REQUEST_QUEUE_SIZE];
+    volatile unsigned int head;
+    volatile unsigned int tail;
+    uint8_t level;
+    uint8_t pattern;
+    uint8_t length;
+    uint8_t step;
+    bool repeat;
+    unsigned int ticks;
+
+    void post(LedManager::tLedState state) {
+      unsigned int next = ((this->head + 1) % LED_REQUEST_QUEUE_SIZE);
+
+      if (next == this->tail) {
+        this->statistics.overflows++;
+        return;
+      }
+      this->requests[this->head] = (uint8_t) state;
+      this->head = next;
+      recordBufferLevel(this->statistics, ((this->head + LED_REQUEST_QUEUE_SIZE - this->tail) % LED_REQUEST_QUEUE_SIZE));
+    }
+
+    // Patterns are read from bit 0, one bit per step.
+    void start(uint8_t state) {
+      this->ticks = 0;
+      this->step = 0;
+      this->repeat = false;
+      switch (state) {
+        case LedManager::OFF: this->level = 0; this->length = 0; break;
+        case LedManager::ON: this->level = 1; this->length = 0; break;
+        case LedManager::ONCE: this->pattern = 0x01; this->length = 2; break;
+        case LedManager::TWICE: this->pattern = 0x05; this->length = 4; break;
+        case LedManager::THRICE: this->pattern = 0x15; this->length = 6; break;
+        case LedManager::FLASH: this->pattern = 0x01; this->length = 2; this->repeat = true; break;
+        default: break;
+      }
+    }
+};
+
+/**
+ * @brief TimerLed objects for operating the CAN and PRG LEDs.
+ */
+TimerLed<GPIO_LED_CAN, ((CAN_LED_UPDATE_INTERVAL * 1000UL) / OPERATOR_INTERFACE_TIMER_TICK)> CanLed("CAN LED requests");
+TimerLed<GPIO_LED_PRG, ((PRG_LED_UPDATE_INTERVAL * 1000UL) / OPERATOR_INTERFACE_TIMER_TICK)> PrgLed("PRG LED requests");
+
+/**
+ * @brief Hardware timer which drives the operator interface and a
+ *        queue through which it posts PRG button events to loop().
+ *
+ * The queue has a single producer (the timer) and a single consumer
+ * (loop()) and so needs no locking.
+ */
+IntervalTimer OperatorInterfaceTimer;
+volatile bool PRGButtonEvents[PRG_BUTTON_EVENT_QUEUE_SIZE];
+volatile unsigned int PRGButtonEventHead = 0;
+volatile unsigned int PRGButtonEventTail = 0;
+volatile bool PRGButtonState;
+tBufferStatistics PRGButtonEventStatistics = { "PRG events", PRG_BUTTON_EVENT_QUEUE_SIZE, true, true, 0, 0 };
+
+void operatorInterfaceTimerHandler() {
+  static unsigned int ticks = 0;
+  bool state = digitalRead(GPIO_BUTTON_PRG);
 
-#include "definitions.h"
+  if (state == PRGButtonState) {
+    ticks = 0;
+  } else if (++ticks >= PRG_BUTTON_DEBOUNCE_TICKS) {
+    ticks = 0;
+    PRGButtonState = state;
+    if (((PRGButtonEventHead + 1) % PRG_BUTTON_EVENT_QUEUE_SIZE) != PRGButtonEventTail) {
+      PRGButtonEvents[PRGButtonEventHead] = state;
+      PRGButtonEventHead = ((PRGButtonEventHead + 1) % PRG_BUTTON_EVENT_QUEUE_SIZE);
+      recordBufferLevel(PRGButtonEventStatistics, ((PRGButtonEventHead + PRG_BUTTON_EVENT_QUEUE_SIZE - PRGButtonEventTail) % PRG_BUTTON_EVENT_QUEUE_SIZE));
+    } else {
+      PRGButtonEventStatistics.overflows++;
+    }
+  }
+  CanLed.tick();
+  PrgLed.tick();
+}
+
+bool getPRGButtonEvent(bool &state) {
+  if (PRGButtonEventTail == PRGButtonEventHead) return(false);
+  state = PRGButtonEvents[PRGButtonEventTail];
+  PRGButtonEventTail = ((PRGButtonEventTail + 1) % PRG_BUTTON_EVENT_QUEUE_SIZE);
+  return(true);
+}
+#endif
+
+/**
+ * @brief Card drivers bound to the MikroBus sockets.
+ */
+MikroBusSockets<MIKROBUS_SOCKET_LEFT_CARD, MIKROBUS_SOCKET_RIGHT_CARD> MikroBus;
+
+#ifdef PERIPHERALIO_H
+/**
+ * @brief Asynchronous SPI and I2C transaction engine for card drivers.
+ *
+ * Created only if the specialisation includes PeripheralIO.h. The I2C
+ * side uses the teensy4_i2c library's Master on the NOP100 I2C pins.
+ */
+PeripheralIO PeripheralBus(Master);
+#endif
+
+#include MODULE_FILE(definitions.h)
 
 /**********************************************************************
  * MAIN PROGRAM - setup()
  */
 void setup() {
+  onPowerUp();
+
   #ifdef DEBUG_SERIAL
   Serial.begin(DEBUG_SERIAL_PORT_SPEED);
   delay(DEBUG_SERIAL_START_DELAY);
@@ -303,26 +663,74 @@ void setup() {
 
   SPI.begin();
 
+  #ifdef OPERATOR_INTERFACE_TIMER_DRIVEN
+  pinMode(GPIO_BUTTON_PRG, INPUT_PULLUP);
+  PRGButtonState = digitalRead(GPIO_BUTTON_PRG);
+  #else
   PRGButton.begin();
+  #endif
 
   CodeSwitchPISO.begin();
   
+  // In timer-driven mode the timer must be running before the LEDs
+  // are used.
+  #ifdef OPERATOR_INTERFACE_TIMER_DRIVEN
+  OperatorInterfaceTimer.begin(operatorInterfaceTimerHandler, OPERATOR_INTERFACE_TIMER_TICK);
+  #endif
+
   // Run a startup sequence in the LED display: all LEDs on to confirm
   // function.
   CanLed.setStatus(0xff); PrgLed.setStatus(0xff);
   delay(100);
   CanLed.setStatus(0x00); PrgLed.setStatus(0x00);
 
-  #include "setup.h"
+  MikroBus.begin();
+
+  #if LOCAL_LOGIC_RULE_COUNT > 0
+  LocalLogic.configure(ModuleConfiguration);
+  ConfigurationChanges.subscribe(LOCAL_LOGIC_CONFIGURATION_INDEX, (LOCAL_LOGIC_CONFIGURATION_INDEX + LOCAL_LOGIC_CONFIGURATION_SIZE - 1), [](unsigned int index, unsigned char value){ LocalLogic.invalidate(); });
+  #endif
+
+  for (unsigned int s = 0; ModuleManifest::Schedulers[s].transmit; s++) {
+    ConfigurationChanges.subscribe(ModuleManifest::Schedulers[s].periodIndex, ModuleManifest::Schedulers[s].periodIndex, [](unsigned int index, unsigned char value){ configureModuleSchedulers(); });
+    ConfigurationChanges.subscribe(ModuleManifest::Schedulers[s].offsetIndex, ModuleManifest::Schedulers[s].offsetIndex, [](unsigned int index, unsigned char value){ configureModuleSchedulers(); });
+  }
+  for (unsigned int s = 0; ModuleManifest::Subscribers[s].handler; s++) {
+    ConfigurationChanges.subscribe(ModuleManifest::Subscribers[s].first, ModuleManifest::Subscribers[s].last, ModuleManifest::Subscribers[s].handler);
+  }
+
+  #include MODULE_FILE(setup.h)
+
+  #ifdef DEBUG_SERIAL
+  if (ConfigurationChanges.getRejectedCount() > 0) {
+    Serial.print("ConfigurationChanges: "); Serial.print(ConfigurationChanges.getRejectedCount());
+    Serial.println(" subscription(s) refused: subscribe through the manifest's Subscribers");
+  }
+  #endif
 
   // Initialise and start N2K services.
+  #if N2K_CAN_MSG_BUF_SIZE > 0
+  NMEA2000.SetN2kCANMsgBufSize(N2K_CAN_MSG_BUF_SIZE);
+  #endif
+  #if N2K_CAN_RECEIVE_FRAME_BUF_SIZE > 0
+  NMEA2000.SetN2kCANReceiveFrameBufSize(N2K_CAN_RECEIVE_FRAME_BUF_SIZE);
+  #endif
+  #if N2K_CAN_SEND_FRAME_BUF_SIZE > 0
+  NMEA2000.SetN2kCANSendFrameBufSize(N2K_CAN_SEND_FRAME_BUF_SIZE);
+  #endif
+  #ifdef PRODUCT_SERIAL_CODE
   NMEA2000.SetProductInformation(PRODUCT_SERIAL_CODE, PRODUCT_CODE, PRODUCT_TYPE, PRODUCT_FIRMWARE_VERSION, PRODUCT_VERSION);
-  NMEA2000.SetDeviceInformation(DEVICE_UNIQUE_NUMBER, DEVICE_FUNCTION, DEVICE_CLASS, DEVICE_MANUFACTURER_CODE);
+  #else
+  char serialCode[16];
+  snprintf(serialCode, sizeof(serialCode), "%03u-%lu", (unsigned int) PRODUCT_CODE, deviceUniqueNumber());
+  NMEA2000.SetProductInformation(serialCode, PRODUCT_CODE, PRODUCT_TYPE, PRODUCT_FIRMWARE_VERSION, PRODUCT_VERSION);
+  #endif
+  NMEA2000.SetDeviceInformation(deviceUniqueNumber(), DEVICE_FUNCTION, DEVICE_CLASS, DEVICE_MANUFACTURER_CODE);
   NMEA2000.SetMode(tNMEA2000::N2km_ListenAndNode, ModuleConfiguration.getByte(MODULE_CONFIGURATION_CAN_SOURCE_INDEX)); // Configure for sending and receiving.
   NMEA2000.EnableForward(false); // Disable all msg forwarding to USB (=Serial)
-  NMEA2000.ExtendTransmitMessages(TransmitMessages); // Tell library which PGNs we transmit
+  NMEA2000.ExtendTransmitMessages(ModuleManifest::TransmittedPGNs); // Tell library which PGNs we transmit
   NMEA2000.SetMsgHandler(messageHandler);
-  NMEA2000.SetOnOpen(onN2kOpen);
+  NMEA2000.SetOnOpen(handleN2kOpen);
   NMEA2000.Open();
 
   #ifdef DEBUG_SERIAL
@@ -346,60 +754,261 @@ void loop() {
   // process any received messages. This call may result in acquisition
   // of a new CAN source address, so we check if there has been any
   // change and if so save the new address to EEPROM for future re-use.
+  recordBufferLevel(N2kTransmitStatistics, N2kTransmitFrames); N2kTransmitFrames = 0;
   NMEA2000.ParseMessages();
+  recordBufferLevel(N2kReceiveStatistics, N2kReceiveFrames); N2kReceiveFrames = 0;
   if (NMEA2000.ReadResetAddressChanged()) {
     ModuleConfiguration.setByte(MODULE_CONFIGURATION_CAN_SOURCE_INDEX, NMEA2000.GetN2kSource());
   }
 
-  #include "loop.h"
-
-  // If the PRG button has been operated, then call the button handler.
-  if (PRGButton.toggled()) {
-    switch (ModuleOperatorInterface.handleButtonEvent(PRGButton.read(), (unsigned char) (CodeSwitchPISO.read() & 0xff))) {
-      case ModuleOperatorInterface::MODE_CHANGE:
-        PrgLed.setLedState(0, LedManager::ONCE);
-        break;
-      case ModuleOperatorInterface::ADDRESS_ACCEPTED:
-        PrgLed.setLedState(0, LedManager::ONCE);
-        break;
-      case ModuleOperatorInterface::ADDRESS_REJECTED:
-        PrgLed.setLedState(0, LedManager::THRICE);
-        break;
-      case ModuleOperatorInterface::VALUE_ACCEPTED:
-        PrgLed.setLedState(0, LedManager::ONCE);
-        break;
-      case ModuleOperatorInterface::VALUE_REJECTED:
-        PrgLed.setLedState(0, LedManager::THRICE);
-        break;
-      default:
-        break;
-    }
+  // Tell subscribers about any configuration changes made since the
+  // last pass.
+  ConfigurationChanges.notify(ModuleConfiguration);
+
+  // Update the bus load estimate and, if periodic transmissions must
+  // now be stretched by a different factor, let the specialisation
+  // reschedule them.
+  if (BusLoad.update(millis())) {
+    #ifdef DEBUG_SERIAL
+    Serial.print("Bus load "); Serial.print(BusLoad.getLoad()); Serial.print("%, stretching periodic transmissions to "); Serial.print(BusLoad.getStretch()); Serial.println("%");
+    #endif
+    configureModuleSchedulers();
+    onBusLoadChange();
   }
 
-  // Update LED outputs.
+  #ifdef PERIPHERALIO_H
+  PeripheralBus.poll();
+  #endif
+
+  MikroBus.poll();
+
+  #include MODULE_FILE(loop.h)
+
+  // Make any periodic transmissions which are due.
+  for (unsigned int s = 0; ModuleManifest::Schedulers[s].transmit; s++) {
+    if (ModuleSchedulers[s].IsTime()) { ModuleSchedulers[s].UpdateNextTime(); ModuleManifest::Schedulers[s].transmit(); }
+  }
+
+  // Evaluate any local logic rules whose inputs have changed, picking
+  // up new rules if the configuration has been updated.
+  #if LOCAL_LOGIC_RULE_COUNT > 0
+  if (LocalLogic.isStale()) LocalLogic.configure(ModuleConfiguration);
+  LocalLogic.evaluate(millis());
+  #endif
+
+  // If the PRG button has been operated, then call the button handler
+  // and, unless the timer drives them, update LED outputs.
+  #ifdef OPERATOR_INTERFACE_TIMER_DRIVEN
+  bool prgButtonState;
+  while (getPRGButtonEvent(prgButtonState)) handlePRGButtonEvent(prgButtonState);
+  #else
+  if (PRGButton.toggled()) handlePRGButtonEvent(PRGButton.read());
   CanLed.update(); PrgLed.update();
+  #endif
   
   // Make sure that we always eventually revert to normal operation.
   ModuleOperatorInterface.revertModeMaybe();
+
+  #ifdef DEBUG_SERIAL
+  reportBufferStatisticsMaybe();
+  #endif
+}
+
+/**
+ * @brief Return the number of CAN frames needed to carry a message.
+ */
+unsigned int n2kFrameCount(const tN2kMsg &N2kMsg) {
+  return((N2kMsg.DataLen <= 8)?1:(1 + ((N2kMsg.DataLen - 6 + 7 - 1) / 7)));
+}
+
+/**
+ * @brief Queue a message for transmission, recording its frames if
+ * the library accepts it and counting an overflow if it does not.
+ *
+ * Specialisations should transmit through this function rather than
+ * calling NMEA2000.SendMsg() directly.
+ *
+ * @param N2kMsg - the message to be transmitted.
+ * @return true if the message was queued.
+ */
+bool transmitMessage(const tN2kMsg &N2kMsg) {
+  unsigned int frames = n2kFrameCount(N2kMsg);
+
+  if (!NMEA2000.SendMsg(N2kMsg)) {
+    N2kTransmitStatistics.overflows++;
+    return(false);
+  }
+  N2kTransmitFrames += frames;
+  BusLoad.count(frames);
+  return(true);
+}
+
+/**********************************************************************
+ * @brief Get the 21-bit unique number for the device's NAME.
+ *
+ * @return DEVICE_UNIQUE_NUMBER if it is non-zero, otherwise the low
+ * 21 bits of the Teensy's factory-programmed serial number.
+ */
+unsigned long deviceUniqueNumber() {
+  #if DEVICE_UNIQUE_NUMBER != 0
+  return(DEVICE_UNIQUE_NUMBER & 0x1FFFFFUL);
+  #else
+  return(HW_OCOTP_MAC0 & 0x1FFFFFUL);
+  #endif
+}
+
+#ifdef DEBUG_SERIAL
+/**
+ * @brief Print buffer statistics to the debug serial port every
+ * BUFFER_STATISTICS_REPORT_INTERVAL milliseconds.
+ */
+void printBufferStatistics(const tBufferStatistics &statistics) {
+  Serial.print("  "); Serial.print(statistics.name);
+  Serial.print(": size "); if (statistics.size) Serial.print(statistics.size); else Serial.print("default");
+  Serial.print((statistics.measuresOccupancy)?", high-water ":", peak per pass "); Serial.print(statistics.highWaterMark);
+  Serial.print(", overflows ");
+  if (statistics.countsOverflows) Serial.println(statistics.overflows); else Serial.println("n/a");
+}
+
+void reportBufferStatisticsMaybe() {
+  static unsigned long deadline = BUFFER_STATISTICS_REPORT_INTERVAL;
+  unsigned long now = millis();
+
+  if ((long) (now - deadline) >= 0) {
+    deadline = (now + BUFFER_STATISTICS_REPORT_INTERVAL);
+    Serial.print("Bus load: "); Serial.print(BusLoad.getLoad());
+    Serial.print("%, peak "); Serial.print(BusLoad.getPeakLoad());
+    Serial.print("%, stretch "); Serial.print(BusLoad.getStretch()); Serial.println("%");
+    Serial.println("Buffer statistics:");
+    printBufferStatistics(N2kReceiveStatistics);
+    printBufferStatistics(N2kTransmitStatistics);
+    #ifdef OPERATOR_INTERFACE_TIMER_DRIVEN
+    printBufferStatistics(PRGButtonEventStatistics);
+    printBufferStatistics(CanLed.statistics);
+    printBufferStatistics(PrgLed.statistics);
+    #endif
+    #ifdef PERIPHERALIO_H
+    for (unsigned int bus = 0; bus < PeripheralIO::BUS_COUNT; bus++) {
+      const PeripheralIO::tStatistics &statistics = PeripheralBus.getStatistics((PeripheralIO::tBus) bus);
+      Serial.print("  "); Serial.print((bus == PeripheralIO::BUS_SPI)?"SPI":"I2C");
+      Serial.print(" queue: size "); Serial.print(PERIPHERAL_IO_QUEUE_SIZE - 1);
+      Serial.print(", high-water "); Serial.print(statistics.maxDepth);
+      Serial.print(", overflows "); Serial.println(statistics.rejected);
+    }
+    #endif
+  }
+}
+#endif
+
+/**
+ * @brief Pass a PRG button state change to the operator interface and
+ * flash the PRG LED to acknowledge the outcome.
+ *
+ * @param state - the new state of the PRG button.
+ */
+void handlePRGButtonEvent(bool state) {
+  switch (ModuleOperatorInterface.handleButtonEvent(state, (unsigned char) (CodeSwitchPISO.read() & 0xff))) {
+    case ModuleOperatorInterface::MODE_CHANGE:
+      PrgLed.setLedState(0, LedManager::ONCE);
+      break;
+    case ModuleOperatorInterface::ADDRESS_ACCEPTED:
+      PrgLed.setLedState(0, LedManager::ONCE);
+      break;
+    case ModuleOperatorInterface::ADDRESS_REJECTED:
+      PrgLed.setLedState(0, LedManager::THRICE);
+      break;
+    case ModuleOperatorInterface::VALUE_ACCEPTED:
+      PrgLed.setLedState(0, LedManager::ONCE);
+      break;
+    case ModuleOperatorInterface::VALUE_REJECTED:
+      PrgLed.setLedState(0, LedManager::THRICE);
+      break;
+    default:
+      break;
+  }
 }
 
 void messageHandler(const tN2kMsg &N2kMsg) {
   int iHandler;
-  for (iHandler=0; NMEA2000Handlers[iHandler].PGN!=0 && !(N2kMsg.PGN==NMEA2000Handlers[iHandler].PGN); iHandler++);
-  if (NMEA2000Handlers[iHandler].PGN != 0) {
-    NMEA2000Handlers[iHandler].Handler(N2kMsg); 
+  unsigned int frames = n2kFrameCount(N2kMsg);
+
+  N2kReceiveFrames += frames;
+  BusLoad.count(frames);
+
+  for (iHandler=0; ModuleManifest::ReceivedPGNs[iHandler].PGN!=0 && !(N2kMsg.PGN==ModuleManifest::ReceivedPGNs[iHandler].PGN); iHandler++);
+  if (ModuleManifest::ReceivedPGNs[iHandler].PGN != 0) {
+    ModuleManifest::ReceivedPGNs[iHandler].handler(N2kMsg); 
   }
 }
 
+/**
+ * @brief Manifest handler for PGN 127501 which mirrors remote
+ * switchbank states into the local logic engine.
+ */
+void handleLocalLogicPGN127501(const tN2kMsg &N2kMsg) {
+  #if (LOCAL_LOGIC_RULE_COUNT > 0) && (LOCAL_LOGIC_REMOTE_BANK_COUNT > 0)
+  unsigned char instance;
+  tN2kBinaryStatus status;
+
+  if (ParseN2kPGN127501(N2kMsg, instance, status)) LocalLogic.receiveSwitchbankStatus(instance, status);
+  #endif
+}
+
+/**
+ * @brief Set the period and offset of every manifest scheduler from
+ * the module configuration, stretching periods if the bus is busy.
+ */
+void configureModuleSchedulers() {
+  for (unsigned int s = 0; ModuleManifest::Schedulers[s].transmit; s++) {
+    ModuleSchedulers[s].SetPeriodAndOffset(
+      (uint32_t) BusLoad.stretch(ModuleConfiguration.getByte(ModuleManifest::Schedulers[s].periodIndex) * ModuleManifest::Schedulers[s].periodUnit),
+      (uint32_t) (ModuleConfiguration.getByte(ModuleManifest::Schedulers[s].offsetIndex) * ModuleManifest::Schedulers[s].offsetUnit)
+    );
+  }
+}
+
+/**
+ * @brief Callback invoked by the NMEA2000 library once the CAN bus is
+ * active which starts the manifest schedulers and then calls
+ * onN2kOpen().
+ */
+void handleN2kOpen() {
+  configureModuleSchedulers();
+  onN2kOpen();
+}
+
+/**
+ * @brief ModuleConfiguration validation callback.
+ *
+ * Configuration bytes owned by NOP100 services are validated by the
+ * service; everything else must lie within the range given in the
+ * manifest and satisfy configurationValidator(). An accepted value
+ * which differs from the current one is recorded so that subscribers
+ * can be notified once it has been stored.
+ */
+bool validateConfiguration(unsigned int index, unsigned char value) {
+  const unsigned int manifestCount = manifestConfigurationCount(ModuleManifest::Configuration);
+  bool valid = ((index < manifestCount) && (value >= ModuleManifest::Configuration[index].minimum) && (value <= ModuleManifest::Configuration[index].maximum) && configurationValidator(index, value));
+
+  #if LOCAL_LOGIC_RULE_COUNT > 0
+  if (LocalLogic.owns(index)) valid = LocalLogic.validate(ModuleConfiguration, index, value);
+  #endif
+
+  if ((valid) && (ModuleConfiguration.getByte(index) != value)) ConfigurationChanges.record(index);
+  return(valid);
+}
+
 #ifndef CONFIGURATION_VALIDATOR
 /**
  * @brief ModuleConfiguration validation callback.
  * 
  * ModuleConfiguration uses this callback to validate update values
- * before they are written into the configuration.
+ * before they are written into the configuration. It is only called
+ * for values which lie within the range given in the manifest.
  * 
- * @attention Specialisations will probably need to override this
- * function and therefore must define CONFIGURATION_VALIDATOR.
+ * @attention Specialisations whose configuration values constrain one
+ * another can override this function and must then define
+ * CONFIGURATION_VALIDATOR.
  * 
  * @param index - the configuration address where value will be stored
  * if validation is successful.
@@ -408,12 +1017,20 @@ void messageHandler(const tN2kMsg &N2kMsg) {
  * @return false - the proposed value is not acceptable.
  */
 bool configurationValidator(unsigned int index, unsigned char value) {
-  switch (index) {
-    case MODULE_CONFIGURATION_CAN_SOURCE_INDEX:
-      return(true);
-    default:
-      return(false);
-  }
+  return(true);
+}
+#endif
+
+#ifndef ON_POWER_UP
+/**
+ * @brief Function called at the very start of setup(), before NOP100
+ * starts its peripherals, runs its LED test or opens the CAN bus.
+ * 
+ * @attention Specialisations which must put their outputs into a
+ * known state without delay can override this function and must then
+ * define ON_POWER_UP.
+ */
+void onPowerUp() {
 }
 #endif
 
@@ -429,3 +1046,18 @@ void onN2kOpen() {
 }
 #endif
 
+#ifndef ON_BUS_LOAD_CHANGE
+/**
+ * @brief Function called when the factor by which periodic
+ * transmissions are stretched changes.
+ * 
+ * NOP100 has already rescheduled the manifest schedulers.
+ * 
+ * @attention Specialisations which stretch other periods with
+ * BusLoad.stretch() can override this function and must then define
+ * ON_BUS_LOAD_CHANGE.
+ */
+void onBusLoadChange() {
+}
+#endif
+
@@ -0,0 +1,234 @@
+/**
+ * @file PeripheralIO.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Queued, asynchronous SPI and I2C transactions for MikroBus
+ * card drivers.
+ * @version 0.1
+ * @date 2024-08-19
+ * @copyright Copyright (c) 2024
+ *
+ * A driver describes a bus transaction in a tTransaction which it owns
+ * and submits to the PeripheralIO object. Each bus has its own queue
+ * and transactions on the SPI and I2C buses proceed concurrently.
+ * SPI transfers run on the i.MX RT1062 DMA engine through the Teensy
+ * SPI library's EventResponder interface; I2C transfers run on the
+ * LPI2C peripheral under interrupt control through the teensy4_i2c
+ * library. Neither ever blocks loop().
+ *
+ * Completion can be handled through a callback, which is invoked from
+ * poll() and therefore in loop() context, or by polling isBusy() on
+ * the transaction. An SPI transfer is closed (chip select released
+ * and the SPI transaction ended) from the DMA completion interrupt,
+ * so the bus is never held reserved across a pass of loop().
+ *
+ * A card driver or specialisation uses the layer by including this
+ * header (and teensy4_i2c's i2c_driver_wire.h in place of Wire.h);
+ * NOP100 then creates the PeripheralIO object declared below and polls
+ * it from loop().
+ */
+
+#ifndef PERIPHERALIO_H
+#define PERIPHERALIO_H
+
+#include <SPI.h>
+#include <EventResponder.h>
+#include <i2c_driver.h>
+#include <imx_rt1060/imx_rt1060_i2c_driver.h>
+
+#ifndef PERIPHERAL_IO_QUEUE_SIZE
+#define PERIPHERAL_IO_QUEUE_SIZE 8
+#endif
+
+class PeripheralIO {
+  public:
+    enum tBus : uint8_t { BUS_SPI, BUS_I2C, BUS_COUNT };
+    enum tStatus : uint8_t { STATUS_IDLE, STATUS_QUEUED, STATUS_ACTIVE, STATUS_DONE, STATUS_ERROR };
+
+    /******************************************************************
+     * @brief A single bus transaction.
+     *
+     * For SPI, device is the chip select pin and txBuffer and
+     * rxBuffer (either of which may be null) are clocked in full
+     * duplex for txCount bytes. For I2C, device is the bus address and
+     * txCount bytes are written and then rxCount bytes are read with a
+     * repeated start between the two.
+     *
+     * Timestamps are in microseconds and are maintained by
+     * PeripheralIO.
+     */
+    struct tTransaction {
+      tBus bus;
+      uint8_t device;
+      SPISettings settings;
+      const uint8_t *txBuffer;
+      size_t txCount;
+      uint8_t *rxBuffer;
+      size_t rxCount;
+      void (*callback)(tTransaction &transaction);
+      void *context;
+      volatile tStatus status;
+      unsigned long queuedAt;
+      unsigned long startedAt;
+      unsigned long completedAt;
+    };
+
+    /******************************************************************
+     * @brief Per-bus queue and timing statistics, times being in
+     * microseconds.
+     */
+    typedef struct {
+      unsigned long transactions;
+      unsigned long errors;
+      unsigned long rejected;
+      unsigned int maxDepth;
+      unsigned long maxWait;
+      unsigned long maxDuration;
+      unsigned long totalDuration;
+    } tStatistics;
+
+    PeripheralIO(I2CMaster &i2c) : i2c(i2c), spiComplete(false), i2cReading(false) {
+      memset(this->queues, 0, sizeof(this->queues));
+      memset(this->statistics, 0, sizeof(this->statistics));
+      this->spiEvent.attachImmediate([](EventResponder &event){ ((PeripheralIO *) event.getContext())->endSPI(); });
+      this->spiEvent.setContext(this);
+    }
+
+    /******************************************************************
+     * @brief Queue a transaction for execution.
+     *
+     * @return false if the bus queue is full or the transaction is
+     * already queued or active.
+     */
+    bool submit(tTransaction &transaction) {
+      tQueue *queue = &this->queues[transaction.bus];
+      unsigned int next = ((queue->tail + 1) % PERIPHERAL_IO_QUEUE_SIZE);
+
+      if (this->isBusy(transaction) || (next == queue->head)) {
+        this->statistics[transaction.bus].rejected++;
+        return(false);
+      }
+      transaction.status = STATUS_QUEUED;
+      transaction.queuedAt = micros();
+      queue->entries[queue->tail] = &transaction;
+      queue->tail = next;
+      if (((queue->tail + PERIPHERAL_IO_QUEUE_SIZE - queue->head) % PERIPHERAL_IO_QUEUE_SIZE) > this->statistics[transaction.bus].maxDepth) {
+        this->statistics[transaction.bus].maxDepth = ((queue->tail + PERIPHERAL_IO_QUEUE_SIZE - queue->head) % PERIPHERAL_IO_QUEUE_SIZE);
+      }
+      return(true);
+    }
+
+    bool isBusy(const tTransaction &transaction) {
+      return((transaction.status == STATUS_QUEUED) || (transaction.status == STATUS_ACTIVE));
+    }
+
+    const tStatistics &getStatistics(tBus bus) { return(this->statistics[bus]); }
+
+    /******************************************************************
+     * @brief Complete finished transactions and start queued ones.
+     *
+     * Called by NOP100 on every pass of loop().
+     */
+    void poll() {
+      tTransaction *transaction;
+
+      if ((transaction = this->active(BUS_SPI)) && (this->spiComplete)) {
+        this->spiComplete = false;
+        this->spiEvent.clearEvent();
+        this->complete(BUS_SPI, STATUS_DONE);
+      }
+
+      if ((transaction = this->active(BUS_I2C)) && (this->i2c.finished())) {
+        if (this->i2c.has_error()) {
+          this->complete(BUS_I2C, STATUS_ERROR);
+        } else if ((!this->i2cReading) && (transaction->rxCount > 0)) {
+          this->i2cReading = true;
+          this->i2c.read_async(transaction->device, transaction->rxBuffer, transaction->rxCount, true);
+        } else {
+          this->complete(BUS_I2C, STATUS_DONE);
+        }
+      }
+
+      if ((!this->active(BUS_SPI)) && (transaction = this->start(BUS_SPI))) {
+        SPI.beginTransaction(transaction->settings);
+        digitalWrite(transaction->device, LOW);
+        SPI.transfer(transaction->txBuffer, transaction->rxBuffer, transaction->txCount, this->spiEvent);
+      }
+
+      if ((!this->active(BUS_I2C)) && (transaction = this->start(BUS_I2C))) {
+        if (transaction->txCount > 0) {
+          this->i2cReading = false;
+          this->i2c.write_async(transaction->device, (uint8_t *) transaction->txBuffer, transaction->txCount, (transaction->rxCount == 0));
+        } else {
+          this->i2cReading = true;
+          this->i2c.read_async(transaction->device, transaction->rxBuffer, transaction->rxCount, true);
+        }
+      }
+    }
+
+  private:
+    typedef struct {
+      tTransaction *entries[PERIPHERAL_IO_QUEUE_SIZE];
+      unsigned int head;
+      unsigned int tail;
+      tTransaction *active;
+    } tQueue;
+
+    I2CMaster &i2c;
+    EventResponder spiEvent;
+    volatile bool spiComplete;
+    bool i2cReading;
+    tQueue queues[BUS_COUNT];
+    tStatistics statistics[BUS_COUNT];
+
+    tTransaction *active(tBus bus) { return(this->queues[bus].active); }
+
+    /******************************************************************
+     * @brief Close the active SPI transfer.
+     *
+     * Called from the DMA completion interrupt. The active transaction
+     * cannot change until poll() has seen spiComplete.
+     */
+    void endSPI() {
+      digitalWrite(this->queues[BUS_SPI].active->device, HIGH);
+      SPI.endTransaction();
+      this->spiComplete = true;
+    }
+
+    tTransaction *start(tBus bus) {
+      tQueue *queue = &this->queues[bus];
+      tTransaction *transaction;
+      unsigned long wait;
+
+      if (queue->head == queue->tail) return(0);
+      transaction = queue->entries[queue->head];
+      queue->head = ((queue->head + 1) % PERIPHERAL_IO_QUEUE_SIZE);
+      transaction->startedAt = micros();
+      wait = (transaction->startedAt - transaction->queuedAt);
+      if (wait > this->statistics[bus].maxWait) this->statistics[bus].maxWait = wait;
+      transaction->status = STATUS_ACTIVE;
+      queue->active = transaction;
+      return(transaction);
+    }
+
+    void complete(tBus bus, tStatus status) {
+      tTransaction *transaction = this->queues[bus].active;
+      unsigned long duration;
+
+      this->queues[bus].active = 0;
+      transaction->completedAt = micros();
+      duration = (transaction->completedAt - transaction->startedAt);
+      this->statistics[bus].transactions++;
+      if (status == STATUS_ERROR) this->statistics[bus].errors++;
+      if (duration > this->statistics[bus].maxDuration) this->statistics[bus].maxDuration = duration;
+      this->statistics[bus].totalDuration += duration;
+      transaction->status = status;
+      if (transaction->callback) transaction->callback(*transaction);
+    }
+};
+
+/**********************************************************************
+ * @brief The PeripheralIO object created by NOP100, PeripheralBus.
+ */
+extern PeripheralIO PeripheralBus;
+
+#endif
@@ -0,0 +1,112 @@
+/**
+ * @file PulseCounter.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Interrupt driven pulse counting with cycle accurate edge
+ * timestamps.
+ * @version 0.1
+ * @date 2024-09-02
+ * @copyright Copyright (c) 2024
+ *
+ * Each counted edge on the input pin raises an interrupt whose handler
+ * increments a pulse count and records the edge time from the
+ * Cortex-M7 cycle counter. Nothing else happens in interrupt context.
+ *
+ * Hardware counting is not used because the MikroBus PWM pins cannot
+ * share one scheme: pin 9 is a QuadTimer input but pin 3 is reachable
+ * only through FlexPWM4 capture, whose edge counter is eight bits
+ * wide, or through XBAR routing. Each edge therefore costs an
+ * exception entry and exit plus the core's GPIO dispatch, an estimated
+ * 150 to 200 cycles at 600MHz (not measured on hardware), so a
+ * channel at 100kHz takes roughly 3 percent of the processor. Fuel
+ * flow and engine speed senders stay well below 10kHz.
+ *
+ * loop() takes snapshots with read(). The count doubles as a sequence
+ * number: read() loads the count, then the timestamp, then the count
+ * again, and retries if an edge has intervened. Handoff therefore needs
+ * neither locks nor disabled interrupts.
+ *
+ * Frequency is measured by pulseFrequency() by reciprocal counting
+ * between the last edges of two snapshots, whichever counters they
+ * came from: (count difference) / (timestamp difference). The
+ * resolution is one processor cycle at any input rate, however short
+ * the gating window. The cycle counter wraps about every 7 seconds at
+ * 600MHz, so the final edges of snapshots used for frequency
+ * measurement must be less than PULSE_COUNTER_MAXIMUM_INTERVAL
+ * milliseconds apart.
+ */
+
+#ifndef PULSECOUNTER_H
+#define PULSECOUNTER_H
+
+/**********************************************************************
+ * @brief Snapshot of a pulse counter.
+ */
+typedef struct {
+  uint32_t count;                       // Number of edges since begin()
+  uint32_t edgeAt;                      // Cycle counter at most recent edge
+} tPulseSnapshot;
+
+#define PULSE_COUNTER_MAXIMUM_INTERVAL 7000UL
+
+/**********************************************************************
+ * @brief Compute the mean pulse frequency between two snapshots.
+ *
+ * @return Frequency in Hz, or zero if fewer than one complete period
+ * lies between the snapshots' final edges.
+ */
+inline double pulseFrequency(const tPulseSnapshot &from, const tPulseSnapshot &to) {
+  uint32_t pulses = (to.count - from.count);
+  uint32_t cycles = (to.edgeAt - from.edgeAt);
+
+  return(((pulses == 0) || (cycles == 0))?0.0:(((double) pulses * F_CPU_ACTUAL) / cycles));
+}
+
+/**********************************************************************
+ * @brief Pulse counter bound to a single input pin.
+ *
+ * The counter's state is static so that the interrupt handler needs no
+ * object pointer; each pin therefore has at most one counter.
+ *
+ * @tparam Pin - the GPIO pin carrying the pulse train.
+ */
+template <uint8_t Pin>
+class PulseCounter {
+  public:
+    /******************************************************************
+     * @brief Start counting.
+     *
+     * @param mode - RISING, FALLING or CHANGE.
+     */
+    static void begin(int mode = RISING) {
+      ARM_DEMCR |= ARM_DEMCR_TRCENA;
+      ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+      pinMode(Pin, INPUT);
+      attachInterrupt(digitalPinToInterrupt(Pin), &edge, mode);
+    }
+
+    static tPulseSnapshot read() {
+      tPulseSnapshot snapshot;
+      uint32_t count;
+
+      do {
+        count = PulseCounter::count;
+        snapshot.edgeAt = PulseCounter::edgeAt;
+        snapshot.count = PulseCounter::count;
+      } while (count != snapshot.count);
+      return(snapshot);
+    }
+
+  private:
+    static volatile uint32_t count;
+    static volatile uint32_t edgeAt;
+
+    static void edge() {
+      PulseCounter::edgeAt = ARM_DWT_CYCCNT;
+      PulseCounter::count = (PulseCounter::count + 1);
+    }
+};
+
+template <uint8_t Pin> volatile uint32_t PulseCounter<Pin>::count = 0;
+template <uint8_t Pin> volatile uint32_t PulseCounter<Pin>::edgeAt = 0;
+
+#endif
@@ -0,0 +1,165 @@
+/**
+ * @file FixedPointFilterTest.cpp
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Host test of the FixedPointFilter.h kernels against a double
+ * precision reference.
+ * @version 0.1
+ * @date 2024-09-20
+ * @copyright Copyright (c) 2024
+ *
+ * The kernels are driven with the filter sizes and cutoffs used by
+ * NOP100-AIM. Tolerances are:
+ *
+ * FirDecimator, quantised coefficients: the fixed-point output must
+ * lie within 0.5 LSB (Q15) of the double precision convolution of the
+ * same input with the same Q15 coefficients. Only the final rounding
+ * may differ.
+ *
+ * FirDecimator, ideal coefficients: the output must lie within
+ * FIR_DESIGN_TOLERANCE LSB of the convolution with the unquantised
+ * windowed-sinc coefficients. The bound covers coefficient
+ * quantisation (at most Taps / 2 LSB of coefficient error, times an
+ * input of at most half full scale) and rounding.
+ *
+ * BiquadLowPass: the Q31 output, as a fraction of full scale, must lie
+ * within BIQUAD_TOLERANCE (2 Q15 LSB) of a double precision direct
+ * form I biquad with the ideal Butterworth coefficients. The error is
+ * dominated by quantisation of a1 and a2 to Q30, which moves the
+ * poles measurably only at the lowest cutoff. After a step the output
+ * must settle to within BIQUAD_SETTLE_TOLERANCE (Q31 LSB) of the
+ * input, however low the cutoff.
+ *
+ * On the host the C equivalent of SMLALD is exercised; the Cortex-M7
+ * instruction itself is not.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "../FixedPointFilter.h"
+
+static const unsigned int TAPS = 32;
+static const unsigned int FACTOR = 10;
+static const unsigned int SAMPLES = 20000;
+static const double FIR_DESIGN_TOLERANCE = 4.0;
+static const double BIQUAD_TOLERANCE = (2.0 / 32768.0);
+static const double BIQUAD_SETTLE_TOLERANCE = 2.0;
+
+static unsigned int Failures = 0;
+
+static void check(bool condition, const char *test, const char *format, double value) {
+  if (!condition) Failures++;
+  printf("%s %s: ", (condition)?"PASS":"FAIL", test);
+  printf(format, value);
+  printf("\n");
+}
+
+/**********************************************************************
+ * @brief Deterministic test signal: a slow square wave (steps) plus
+ * a sine and uniform noise, never exceeding half of Q15 full scale.
+ */
+static int16_t signal(unsigned int n) {
+  static uint32_t seed = 12345;
+  double value;
+
+  seed = ((seed * 1103515245) + 12345);
+  value = (((n / 1500) % 2)?8000.0:-6000.0) + (4000.0 * sin(n * 0.013)) + ((double) ((seed >> 16) % 8001) - 4000.0);
+  return((int16_t) lround(value));
+}
+
+/**********************************************************************
+ * @brief Windowed-sinc design as in FirDecimator::design(), without
+ * quantisation.
+ */
+static void designIdealFir(double cutoff, double *h) {
+  double scale = 0.0;
+
+  for (unsigned int i = 0; i < TAPS; i++) {
+    double n = (i - ((TAPS - 1) / 2.0));
+    h[i] = (sin(2.0 * M_PI * cutoff * n) / (M_PI * n)) * (0.54 - (0.46 * cos((2.0 * M_PI * i) / (TAPS - 1))));
+    scale += h[i];
+  }
+  for (unsigned int i = 0; i < TAPS; i++) h[i] /= scale;
+}
+
+static void testFirDecimator() {
+  FirDecimator<TAPS, FACTOR> filter;
+  double cutoff = (0.4 / FACTOR);
+  double ideal[TAPS];
+  int16_t input[SAMPLES];
+  int16_t output;
+  long sum = 0;
+  unsigned int outputs = 0;
+  unsigned int misphased = 0;
+  double quantisedError = 0.0;
+  double designError = 0.0;
+
+  filter.design(cutoff);
+  designIdealFir(cutoff, ideal);
+  for (unsigned int i = 0; i < TAPS; i++) sum += filter.getCoefficients()[i];
+  check(sum == 32768, "FIR coefficients sum to unity", "sum %.0f", sum);
+
+  for (unsigned int n = 0; n < SAMPLES; n++) {
+    input[n] = signal(n);
+    if (filter.push(input[n], output)) {
+      double quantised = 0.0;
+      double exact = 0.0;
+
+      if (((n + 1) % FACTOR) != 0) misphased++;
+      for (unsigned int i = 0; i < TAPS; i++) {
+        double x = ((n + 1 + i) >= TAPS)?input[n + 1 + i - TAPS]:0.0;
+        quantised += (filter.getCoefficients()[i] * x) / 32768.0;
+        exact += (ideal[i] * x);
+      }
+      if (fabs(output - quantised) > quantisedError) quantisedError = fabs(output - quantised);
+      if (fabs(output - exact) > designError) designError = fabs(output - exact);
+      outputs++;
+    }
+  }
+  check(outputs == (SAMPLES / FACTOR), "FIR decimation count", "%.0f outputs", outputs);
+  check(misphased == 0, "FIR outputs on decimation phase", "%.0f misphased", misphased);
+  check(quantisedError <= 0.5, "FIR vs double, quantised coefficients (<= 0.5 LSB)", "max error %.3f LSB", quantisedError);
+  check(designError <= FIR_DESIGN_TOLERANCE, "FIR vs double, ideal coefficients (<= 4 LSB)", "max error %.3f LSB", designError);
+}
+
+static void testBiquad(double cutoff) {
+  BiquadLowPass filter;
+  double w = (2.0 * M_PI * cutoff);
+  double alpha = (sin(w) / (2.0 * M_SQRT1_2));
+  double a0 = (1.0 + alpha);
+  double b0 = (((1.0 - cos(w)) / 2.0) / a0), b1 = ((1.0 - cos(w)) / a0), b2 = b0;
+  double a1 = ((2.0 * cos(w)) / a0), a2 = (-(1.0 - alpha) / a0);
+  double x1 = 0.0, x2 = 0.0, y1 = 0.0, y2 = 0.0;
+  double error = 0.0;
+  int32_t output = 0;
+  int16_t step = 12345;
+  char name[80];
+
+  filter.design(cutoff);
+  filter.reset(0);
+  for (unsigned int n = 0; n < (20 * SAMPLES); n++) {
+    int16_t sample = signal(n);
+    double x = (sample / 32768.0);
+    double y = ((b0 * x) + (b1 * x1) + (b2 * x2) + (a1 * y1) + (a2 * y2));
+
+    output = filter.process(sample);
+    x2 = x1; x1 = x; y2 = y1; y1 = y;
+    if (fabs((output / 2147483648.0) - y) > error) error = fabs((output / 2147483648.0) - y);
+  }
+  snprintf(name, sizeof(name), "biquad vs double at cutoff %g (<= 2 Q15 LSB)", cutoff);
+  check(error <= BIQUAD_TOLERANCE, name, "max error %.3f Q15 LSB", error * 32768.0);
+
+  filter.reset(0);
+  for (unsigned long n = 0; n < (unsigned long) (100.0 / cutoff); n++) output = filter.process(step);
+  snprintf(name, sizeof(name), "biquad step settles at cutoff %g (<= %g LSB)", cutoff, BIQUAD_SETTLE_TOLERANCE);
+  check(fabs(output - (step * 65536.0)) <= BIQUAD_SETTLE_TOLERANCE, name, "residual %.0f Q31 LSB", fabs(output - (step * 65536.0)));
+}
+
+int main() {
+  testFirDecimator();
+  testBiquad(0.0255);
+  testBiquad(0.001);
+  testBiquad(0.0001);
+  printf("%u failure(s)\n", Failures);
+  return((Failures == 0)?EXIT_SUCCESS:EXIT_FAILURE);
+}
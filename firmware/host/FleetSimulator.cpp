@@ -0,0 +1,667 @@
+/**
+ * @file FleetSimulator.cpp
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Host simulation of a fleet of NOP100 modules sharing one
+ * NMEA 2000 bus.
+ * @version 0.1
+ * @date 2024-09-20
+ * @copyright Copyright (c) 2024
+ *
+ * A mixed fleet of SIM, ROM and TSM nodes is powered up on a
+ * VirtualCanBus, first with default configuration (cold start: every
+ * node claims the default source address) and then again from the
+ * addresses each node saved (warm start). The report gives, for each
+ * start:
+ *
+ * - the time from the first power-up to the end of the last address
+ *   claim, and the number of address changes and EEPROM writes;
+ * - nodes left sharing an address, and the node-seconds during which
+ *   a node's live address differed from the one in its EEPROM;
+ * - queue-to-wire latency percentiles for address claims, scheduled
+ *   and event messages and library heartbeats;
+ * - bus utilisation measured on the wire and as estimated by each
+ *   node's BusLoad.h monitor, and the largest stretch applied;
+ * - error frames, bus-off events, receive queue high water and
+ *   overflows and refused transmissions.
+ *
+ * Every module parameter the simulation uses (NAME fields, default
+ * source address, bus load parameters, manifest transmit periods,
+ * temperature channel count, heartbeat period and holdoff) comes from
+ * the module's own files through ModuleProfile.h, and each node's bus
+ * load estimate is the BusLoad.h monitor NOP100.cpp creates for its
+ * module.
+ *
+ * The NMEA2000 library is not built on the host. Each node drives a
+ * VirtualCanDriver, which has the library's CAN driver hooks, and
+ * models the library and module behaviour which matters to the fleet:
+ *
+ * - The NAME is built from SetDeviceInformation() as NOP100.cpp calls
+ *   it. Each node has its own serial number, so NAMEs are unique
+ *   unless a module sets DEVICE_UNIQUE_NUMBER or --device-unique-number
+ *   gives every node the same one.
+ * - Address claim (PGN 60928) follows ISO 11783-5 as the library
+ *   implements it: a node which hears a claim for its own address
+ *   re-asserts the claim if its NAME is lower and otherwise moves to
+ *   the next address and claims again. A claim is complete after
+ *   ADDRESS_CLAIM_TIMEOUT without contest; until then the node refuses
+ *   to send application messages.
+ * - Every address change is written to EEPROM from the next loop(),
+ *   as NOP100.cpp does. --save-delay instead writes once the address
+ *   has been stable for the given time, to quantify that alternative.
+ * - Scheduled transmissions follow the first scheduler in the module
+ *   manifest on the tN2kSyncScheduler grid; TSM heartbeats are
+ *   staggered and advanced as scheduleTemperatureHeartbeats() and
+ *   processTemperatureChannel() do. Both are stretched by the node's
+ *   BusLoad.h monitor. Events arrive as a Poisson process.
+ *
+ * Two nodes with the same NAME which claim the same address at the
+ * same moment send identical claim frames. These merge on the wire, so
+ * neither node hears the other and both keep the address. The report
+ * counts nodes left sharing an address.
+ *
+ * Usage: FleetSimulator [option...]
+ *
+ *   --sim n, --rom n, --tsm n   fleet composition (default 20, 20, 15)
+ *   --duration s               length of each start (default 120)
+ *   --start-jitter ms          power-up spread (default 500)
+ *   --event-interval s         mean interval between events per event
+ *                              source (default 30)
+ *   --loop-period us           node loop() period (default 1000)
+ *   --rx-frames n, --tx-frames n  driver queue depths (default 32, 40)
+ *   --save-delay ms            defer EEPROM writes (default 0)
+ *   --device-unique-number n   build every node with this
+ *                              DEVICE_UNIQUE_NUMBER (default: from
+ *                              each node's serial number)
+ *   --seed n                   random seed (default 1)
+ *
+ * The exit status is non-zero if an option is invalid or a check on
+ * the simulation fails. A fleet whose NAMEs are all different must
+ * converge on distinct addresses, must keep them on a warm start
+ * without writing EEPROM and, when saves are deferred for longer than
+ * the claims take to settle, must write each node's address at most
+ * once per start. A fleet with shared NAMEs is reported, not failed.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <map>
+#include <queue>
+#include <random>
+#include <vector>
+#include "ModuleProfile.h"
+#include "VirtualCanBus.h"
+
+/**********************************************************************
+ * Parameters of the NMEA2000 library model.
+ */
+#define ADDRESS_CLAIM_TIMEOUT 250UL
+#define HEARTBEAT_PERIOD 60000UL
+#define MAXIMUM_SOURCE_ADDRESS 251
+#define SETUP_DURATION 200000ULL
+
+enum tVariant { VARIANT_SIM, VARIANT_ROM, VARIANT_TSM, VARIANT_COUNT };
+
+static const tModuleProfile *Profiles[VARIANT_COUNT] = { &ModuleProfile_SIM, &ModuleProfile_ROM, &ModuleProfile_TSM };
+
+enum tMessageClass { CLASS_CLAIM, CLASS_SCHEDULED, CLASS_EVENT, CLASS_HEARTBEAT, CLASS_COUNT };
+
+static const char *MessageClassNames[CLASS_COUNT] = { "address claim", "scheduled", "event", "heartbeat" };
+
+struct tOptions {
+  unsigned int sim;
+  unsigned int rom;
+  unsigned int tsm;
+  unsigned long duration;
+  unsigned long startJitter;
+  double eventInterval;
+  unsigned long loopPeriod;
+  unsigned int rxFrames;
+  unsigned int txFrames;
+  unsigned long saveDelay;
+  unsigned long deviceUniqueNumber;
+  unsigned long seed;
+};
+
+/**********************************************************************
+ * @brief Summary of one start, for the checks made across starts.
+ */
+struct tStartResult {
+  bool converged;
+  tSimTime settleTime;
+  unsigned long addressChanges;
+  unsigned long eepromWrites;
+  unsigned long maximumEepromWrites;
+  bool saved;
+};
+
+/**********************************************************************
+ * @brief Get the first time on the grid Origin + Offset + k * Period
+ * which is later than Now, as tN2kSyncScheduler does.
+ */
+static unsigned long nextOnGrid(unsigned long origin, unsigned long offset, unsigned long period, unsigned long now) {
+  unsigned long start = (origin + offset);
+
+  if (now < start) return(start);
+  return(start + ((((now - start) / period) + 1) * period));
+}
+
+/**********************************************************************
+ * @brief Simulation of one NOP100 module.
+ */
+class SimulatedNode {
+  public:
+    SimulatedNode(VirtualCanBus &bus, tVariant variant, unsigned int instance, unsigned long serialNumber, const tOptions &options) :
+      variant(variant), profile(*Profiles[variant]), instance(instance), options(options), driver(bus, options.txFrames, options.rxFrames), random(options.seed * 1000003UL + serialNumber * 7919UL + instance), busLoad(0),
+      nextChannelHeartbeat(profile.temperatureChannelCount), nextChannelEvent(profile.temperatureChannelCount), channelReportedAt(profile.temperatureChannelCount) {
+      this->name = ((uint64_t) (this->getUniqueNumber(serialNumber) & 0x1fffff));
+      this->name |= ((uint64_t) (this->profile.deviceManufacturerCode & 0x7ff) << 21);
+      this->name |= ((uint64_t) this->profile.deviceFunction << 40);
+      this->name |= ((uint64_t) (this->profile.deviceClass & 0x7f) << 49);
+      this->name |= ((uint64_t) (this->profile.deviceIndustryGroup & 0x07) << 60);
+      this->name |= ((uint64_t) 1 << 63);
+      this->eepromSource = this->profile.canSourceDefault;
+      bus.attach(&this->driver);
+    }
+
+    ~SimulatedNode() { delete this->busLoad; }
+
+    /******************************************************************
+     * @brief Power the node up at a given time.
+     */
+    void powerUp(tSimTime at) {
+      this->driver.reset();
+      this->poweredAt = at;
+      this->openAt = (at + SETUP_DURATION);
+      this->nextTick = (this->openAt + (this->random() % this->options.loopPeriod));
+      this->opened = false;
+      this->source = this->eepromSource;
+      this->savePending = false;
+      this->addressChanges = 0;
+      this->eepromWrites = 0;
+      this->claimRefusals = 0;
+      this->unsavedTime = 0;
+      this->maximumStretch = 100;
+      delete this->busLoad;
+      this->busLoad = this->profile.createBusLoad();
+    }
+
+    /******************************************************************
+     * @brief Run one pass of loop().
+     */
+    void tick(tSimTime now) {
+      unsigned long ms = (unsigned long) ((now - this->poweredAt) / 1000);
+      unsigned long id;
+      unsigned char len;
+      unsigned char buf[8];
+
+      this->nextTick += this->options.loopPeriod;
+      if (!this->opened) this->open(ms);
+
+      if (this->source != this->eepromSource) this->unsavedTime += this->options.loopPeriod;
+
+      while (this->driver.CANGetFrame(id, len, buf)) {
+        this->busLoad->count(1);
+        this->receive(id, len, buf, ms);
+      }
+
+      if ((this->claiming) && ((ms - this->claimStartedAt) >= ADDRESS_CLAIM_TIMEOUT)) {
+        this->claiming = false;
+        this->claimCompletedAt = now;
+      }
+
+      if ((this->savePending) && ((ms - this->sourceChangedAt) >= this->options.saveDelay)) {
+        this->savePending = false;
+        if (this->eepromSource != this->source) {
+          this->eepromSource = this->source;
+          this->eepromWrites++;
+        }
+      }
+
+      if (this->busLoad->update(ms)) {
+        this->maximumStretch = std::max(this->maximumStretch, this->busLoad->getStretch());
+        this->configureSchedulers(ms);
+      }
+
+      this->transmitScheduled(ms);
+      this->transmitEvents(ms);
+    }
+
+    tVariant getVariant() const { return(this->variant); }
+    uint8_t getSource() const { return(this->source); }
+    uint8_t getEepromSource() const { return(this->eepromSource); }
+    uint64_t getName() const { return(this->name); }
+    tSimTime getPoweredAt() const { return(this->poweredAt); }
+    tSimTime getClaimCompletedAt() const { return(this->claimCompletedAt); }
+    bool isClaiming() const { return(this->claiming); }
+    unsigned long getAddressChanges() const { return(this->addressChanges); }
+    unsigned long getEepromWrites() const { return(this->eepromWrites); }
+    unsigned long getClaimRefusals() const { return(this->claimRefusals); }
+    tSimTime getUnsavedTime() const { return(this->unsavedTime); }
+    unsigned int getMaximumStretch() const { return(this->maximumStretch); }
+    unsigned int getPeakLoadEstimate() { return(this->busLoad->getPeakLoad()); }
+    const VirtualCanDriver &getDriver() const { return(this->driver); }
+
+    tSimTime nextTick;
+
+  private:
+    tVariant variant;
+    const tModuleProfile &profile;
+    unsigned int instance;
+    const tOptions &options;
+    VirtualCanDriver driver;
+    std::mt19937_64 random;
+    tBusLoadEstimate *busLoad;
+    uint64_t name;
+    uint8_t source;
+    uint8_t eepromSource;
+    tSimTime poweredAt;
+    tSimTime openAt;
+    tSimTime claimCompletedAt;
+    bool opened;
+    bool claiming;
+    unsigned long claimStartedAt;
+    bool savePending;
+    unsigned long sourceChangedAt;
+    unsigned long syncOrigin;
+    unsigned long nextScheduled;
+    unsigned long nextHeartbeat;
+    std::vector<unsigned long> nextChannelHeartbeat;
+    std::vector<unsigned long> nextChannelEvent;
+    std::vector<unsigned long> channelReportedAt;
+    unsigned long nextEvent;
+    unsigned char sequence;
+    unsigned long addressChanges;
+    unsigned long eepromWrites;
+    unsigned long claimRefusals;
+    tSimTime unsavedTime;
+    unsigned int maximumStretch;
+
+    /******************************************************************
+     * @brief deviceUniqueNumber(): DEVICE_UNIQUE_NUMBER if it is set,
+     * otherwise the serial number.
+     */
+    unsigned long getUniqueNumber(unsigned long serialNumber) const {
+      if (this->options.deviceUniqueNumber != 0) return(this->options.deviceUniqueNumber);
+      if (this->profile.deviceUniqueNumber != 0) return(this->profile.deviceUniqueNumber);
+      return(serialNumber);
+    }
+
+    /******************************************************************
+     * @brief NMEA2000.Open(): start the address claim and, through
+     * handleN2kOpen(), the module schedulers.
+     */
+    void open(unsigned long ms) {
+      this->opened = true;
+      this->driver.CANOpen();
+      this->claimCompletedAt = 0;
+      this->startClaim(ms);
+      this->syncOrigin = ms;
+      this->nextHeartbeat = (ms + HEARTBEAT_PERIOD);
+      this->nextEvent = (ms + this->exponential());
+      for (unsigned int c = 0; c < this->profile.temperatureChannelCount; c++) {
+        this->nextChannelEvent[c] = (ms + this->exponential());
+        this->channelReportedAt[c] = ms;
+      }
+      this->sequence = 0;
+      this->configureSchedulers(ms);
+    }
+
+    unsigned long exponential() {
+      std::exponential_distribution<double> distribution(1.0 / (this->options.eventInterval * 1000.0));
+
+      return((unsigned long) distribution(this->random) + 1);
+    }
+
+    /******************************************************************
+     * @brief configureModuleSchedulers() and
+     * scheduleTemperatureHeartbeats(), with every temperature channel
+     * fitted.
+     */
+    void configureSchedulers(unsigned long ms) {
+      unsigned long period = this->busLoad->stretch(this->profile.temperatureHeartbeatPeriod);
+
+      if (this->profile.transmitPeriod > 0) {
+        this->nextScheduled = nextOnGrid(this->syncOrigin, this->profile.transmitOffset, this->busLoad->stretch(this->profile.transmitPeriod), ms);
+      }
+      for (unsigned int c = 0; c < this->profile.temperatureChannelCount; c++) {
+        this->nextChannelHeartbeat[c] = (ms + ((period * (c + 1)) / this->profile.temperatureChannelCount));
+      }
+    }
+
+    void startClaim(unsigned long ms) {
+      this->claiming = true;
+      this->claimStartedAt = ms;
+      this->sendClaim();
+    }
+
+    void sendClaim() {
+      unsigned char buf[8];
+
+      for (unsigned int i = 0; i < 8; i++) buf[i] = (unsigned char) (this->name >> (8 * i));
+      this->driver.setTag(CLASS_CLAIM);
+      this->driver.CANSendFrame((6UL << 26) | (0xEEUL << 16) | (0xFFUL << 8) | this->source, 8, buf);
+    }
+
+    /******************************************************************
+     * @brief tNMEA2000 handling of received frames; only address
+     * claims concern the model.
+     */
+    void receive(unsigned long id, unsigned char len, const unsigned char *buf, unsigned long ms) {
+      uint64_t callerName = 0;
+
+      if ((((id >> 16) & 0xff) != 0xEE) || ((id & 0xff) != this->source) || (len != 8)) return;
+
+      for (unsigned int i = 0; i < 8; i++) callerName |= ((uint64_t) buf[i] << (8 * i));
+      if (this->name < callerName) {
+        this->sendClaim();
+      } else {
+        this->source = ((this->source + 1) % (MAXIMUM_SOURCE_ADDRESS + 1));
+        this->addressChanges++;
+        this->sourceChangedAt = ms;
+        this->savePending = true;
+        this->startClaim(ms);
+      }
+    }
+
+    /******************************************************************
+     * @brief transmitMessage(): count the frame into the bus load
+     * estimate and queue it, unless an address claim is pending.
+     */
+    bool transmit(tMessageClass messageClass, unsigned int priority, unsigned long pgn, const unsigned char *buf) {
+      if (this->claiming) {
+        this->claimRefusals++;
+        return(false);
+      }
+      this->busLoad->count(1);
+      this->driver.setTag(messageClass);
+      return(this->driver.CANSendFrame(((unsigned long) priority << 26) | (pgn << 8) | this->source, 8, buf));
+    }
+
+    void transmit127501(tMessageClass messageClass) {
+      unsigned char buf[8] = { (unsigned char) this->instance, 0, 0, 0, 0, 0, 0, 0 };
+
+      for (unsigned int i = 1; i < 8; i++) buf[i] = (unsigned char) this->random();
+      this->transmit(messageClass, 3, 127501UL, buf);
+    }
+
+    void transmit130316(tMessageClass messageClass, unsigned int channel) {
+      unsigned char buf[8] = { this->sequence++, (unsigned char) ((this->instance * this->profile.temperatureChannelCount) + channel), 0, 0, 0, 0, 0xff, 0xff };
+
+      for (unsigned int i = 2; i < 6; i++) buf[i] = (unsigned char) this->random();
+      this->transmit(messageClass, 5, 130316UL, buf);
+    }
+
+    void transmitScheduled(unsigned long ms) {
+      if ((long) (ms - this->nextHeartbeat) >= 0) {
+        unsigned char buf[8] = { (unsigned char) (HEARTBEAT_PERIOD & 0xff), (unsigned char) (HEARTBEAT_PERIOD >> 8), this->sequence++, 0xff, 0xff, 0xff, 0xff, 0xff };
+
+        this->nextHeartbeat += HEARTBEAT_PERIOD;
+        this->transmit(CLASS_HEARTBEAT, 7, 126993UL, buf);
+      }
+
+      if ((this->profile.transmitPeriod > 0) && ((long) (ms - this->nextScheduled) >= 0)) {
+        this->nextScheduled = nextOnGrid(this->syncOrigin, this->profile.transmitOffset, this->busLoad->stretch(this->profile.transmitPeriod), ms);
+        this->transmit127501(CLASS_SCHEDULED);
+      }
+    }
+
+    /******************************************************************
+     * @brief Switch events for SIM and ROM, and for TSM
+     * processTemperatureChannel(): a channel is reported on an event
+     * once the holdoff has passed or when its heartbeat falls due, and
+     * a report advances a due heartbeat in whole periods.
+     */
+    void transmitEvents(unsigned long ms) {
+      unsigned long period = this->busLoad->stretch(this->profile.temperatureHeartbeatPeriod);
+
+      if ((this->variant != VARIANT_TSM) && ((long) (ms - this->nextEvent) >= 0)) {
+        this->nextEvent = (ms + this->exponential());
+        this->transmit127501(CLASS_EVENT);
+      }
+      for (unsigned int c = 0; c < this->profile.temperatureChannelCount; c++) {
+        bool heartbeat = ((long) (ms - this->nextChannelHeartbeat[c]) >= 0);
+        bool event = (((long) (ms - this->nextChannelEvent[c]) >= 0) && ((ms - this->channelReportedAt[c]) >= this->profile.temperatureHoldoff));
+
+        if (event) this->nextChannelEvent[c] = (ms + this->exponential());
+        if (event || heartbeat) {
+          this->transmit130316((event)?CLASS_EVENT:CLASS_SCHEDULED, c);
+          this->channelReportedAt[c] = ms;
+          if (period > 0) while ((long) (ms - this->nextChannelHeartbeat[c]) >= 0) this->nextChannelHeartbeat[c] += period;
+        }
+      }
+    }
+};
+
+/**********************************************************************
+ * @brief Percentile of a sorted sample, by nearest rank.
+ */
+static double percentile(const std::vector<double> &sorted, double p) {
+  size_t rank;
+
+  if (sorted.empty()) return(0.0);
+  rank = (size_t) ceil((p / 100.0) * sorted.size());
+  return(sorted[(rank > 0)?(rank - 1):0]);
+}
+
+static unsigned int Failures = 0;
+
+static void check(bool condition, const char *description) {
+  if (!condition) {
+    Failures++;
+    printf("FAIL %s\n", description);
+  }
+}
+
+/**********************************************************************
+ * @brief Power up the whole fleet and run it for options.duration
+ * seconds, then print the report.
+ */
+static tStartResult runStart(const char *title, std::vector<SimulatedNode *> &nodes, VirtualCanBus &bus, tSimTime startAt, const tOptions &options, std::mt19937_64 &random) {
+  std::vector<double> latencies[CLASS_COUNT];
+  std::vector<double> utilisation;
+  tSimTime endAt = (startAt + ((tSimTime) options.duration * 1000000ULL));
+  tSimTime firstPowerUp = SIM_TIME_NEVER;
+  tSimTime lastClaim = 0;
+  tSimTime windowStartedAt = startAt;
+  tSimTime windowBusyTime = bus.getBusyTime();
+  tSimTime now = startAt;
+  unsigned long framesAtStart = bus.getFrames();
+  unsigned long errorFramesAtStart = bus.getErrorFrames();
+  unsigned long mergedFramesAtStart = bus.getMergedFrames();
+  unsigned long long bitsOnWire = 0;
+  unsigned long addressChanges = 0, maximumAddressChanges = 0;
+  unsigned long eepromWrites = 0, maximumEepromWrites = 0;
+  unsigned long claimRefusals = 0, txRefused = 0, rxOverflows = 0, busOffs = 0;
+  size_t rxHighWater = 0;
+  unsigned int maximumStretch = 100, peakLoadEstimate = 0;
+  double unsavedTime = 0.0;
+  std::map<uint8_t, std::vector<SimulatedNode *>> owners;
+  std::priority_queue<std::pair<tSimTime, size_t>, std::vector<std::pair<tSimTime, size_t>>, std::greater<std::pair<tSimTime, size_t>>> ticks;
+  unsigned int duplicates = 0, identicalDuplicates = 0, claiming = 0;
+  bool saved = true;
+
+  bus.setListener([&](const tCanFrame &frame, tSimTime, tSimTime ended, unsigned int senders) {
+    latencies[frame.tag].push_back((double) (ended - frame.queuedAt) / 1000.0);
+    if (senders > 0) bitsOnWire += canFrameBits(frame) / senders;
+  });
+
+  bus.reset();
+  for (SimulatedNode *node : nodes) {
+    node->powerUp(startAt + ((random() % ((options.startJitter * 1000ULL) + 1))));
+    firstPowerUp = std::min(firstPowerUp, node->getPoweredAt());
+  }
+
+  for (size_t n = 0; n < nodes.size(); n++) ticks.push(std::make_pair(nodes[n]->nextTick, n));
+
+  while (now < endAt) {
+    tSimTime next;
+
+    bus.advance(now);
+    while (ticks.top().first <= now) {
+      size_t n = ticks.top().second;
+
+      ticks.pop();
+      nodes[n]->tick(now);
+      ticks.push(std::make_pair(nodes[n]->nextTick, n));
+    }
+    bus.advance(now);
+    while ((now - windowStartedAt) >= 1000000ULL) {
+      utilisation.push_back((100.0 * (bus.getBusyTime() - windowBusyTime)) / 1000000.0);
+      windowBusyTime = bus.getBusyTime();
+      windowStartedAt += 1000000ULL;
+    }
+
+    next = std::min(bus.nextEvent(), ticks.top().first);
+    next = std::min<tSimTime>(next, windowStartedAt + 1000000ULL);
+    now = std::max(next, now + 1);
+  }
+
+  for (SimulatedNode *node : nodes) {
+    lastClaim = std::max(lastClaim, node->getClaimCompletedAt());
+    addressChanges += node->getAddressChanges();
+    maximumAddressChanges = std::max(maximumAddressChanges, node->getAddressChanges());
+    eepromWrites += node->getEepromWrites();
+    maximumEepromWrites = std::max(maximumEepromWrites, node->getEepromWrites());
+    claimRefusals += node->getClaimRefusals();
+    txRefused += node->getDriver().getTxRefused();
+    rxOverflows += node->getDriver().getRxOverflows();
+    busOffs += node->getDriver().getBusOffCount();
+    rxHighWater = std::max(rxHighWater, node->getDriver().getRxHighWater());
+    maximumStretch = std::max(maximumStretch, node->getMaximumStretch());
+    peakLoadEstimate = std::max(peakLoadEstimate, node->getPeakLoadEstimate());
+    unsavedTime += (node->getUnsavedTime() / 1000000.0);
+    owners[node->getSource()].push_back(node);
+    if (node->isClaiming()) claiming++;
+    if (node->getSource() != node->getEepromSource()) saved = false;
+  }
+  for (auto &owner : owners) {
+    if (owner.second.size() < 2) continue;
+    duplicates += owner.second.size();
+    for (SimulatedNode *node : owner.second) {
+      if (node->getName() == owner.second[0]->getName()) identicalDuplicates++;
+    }
+  }
+
+  printf("\n%s start: %zu nodes, %lu s\n", title, nodes.size(), options.duration);
+  if (claiming == 0) {
+    printf("  Address claims complete:    %.1f ms after first power-up\n", (lastClaim - firstPowerUp) / 1000.0);
+  } else {
+    printf("  Address claims complete:    not converged, %u nodes still claiming\n", claiming);
+  }
+  printf("  Address changes:            %lu (mean %.2f, max %lu per node)\n", addressChanges, (double) addressChanges / nodes.size(), maximumAddressChanges);
+  printf("  EEPROM writes:              %lu (mean %.2f, max %lu per node)\n", eepromWrites, (double) eepromWrites / nodes.size(), maximumEepromWrites);
+  printf("  Address unsaved:            %.1f node-seconds\n", unsavedTime);
+  printf("  Nodes sharing an address:   %u (%u with the same NAME)\n", duplicates, identicalDuplicates);
+  printf("  Latency, queue to wire (ms):\n");
+  for (unsigned int c = 0; c < CLASS_COUNT; c++) {
+    std::sort(latencies[c].begin(), latencies[c].end());
+    printf("    %-14s n=%-7zu p50 %7.3f  p90 %7.3f  p99 %7.3f  max %7.3f\n", MessageClassNames[c], latencies[c].size(), percentile(latencies[c], 50), percentile(latencies[c], 90), percentile(latencies[c], 99), percentile(latencies[c], 100));
+  }
+  std::vector<double> sortedUtilisation = utilisation;
+  std::sort(sortedUtilisation.begin(), sortedUtilisation.end());
+  double meanUtilisation = 0.0;
+  for (double u : utilisation) meanUtilisation += u;
+  meanUtilisation = (utilisation.empty())?0.0:(meanUtilisation / utilisation.size());
+  unsigned long frames = (bus.getFrames() - framesAtStart);
+  printf("  Bus utilisation (1 s):      mean %.1f%%, p90 %.1f%%, peak %.1f%%\n", meanUtilisation, percentile(sortedUtilisation, 90), percentile(sortedUtilisation, 100));
+  printf("  BusLoad.h estimate:         peak %u%%, mean frame %.1f bits (assumed %u), max stretch %u%%\n", peakLoadEstimate, (frames > 0)?((double) bitsOnWire / frames):0.0, Profiles[VARIANT_SIM]->busBitsPerFrame, maximumStretch);
+  printf("  Frames:                     %lu (%lu merged), %lu error frames, %lu bus-off\n", frames, bus.getMergedFrames() - mergedFramesAtStart, bus.getErrorFrames() - errorFramesAtStart, busOffs);
+  printf("  Driver queues:              RX high water %zu/%u, RX overflows %lu, TX refused %lu\n", rxHighWater, options.rxFrames, rxOverflows, txRefused);
+  printf("  Refused during claim:       %lu\n", claimRefusals);
+
+  check(lastClaim >= firstPowerUp, "address claims complete after power-up");
+  check((claiming > 0) || (duplicates == identicalDuplicates), "converged nodes with different NAMEs never share an address");
+  check(eepromWrites <= addressChanges, "EEPROM writes do not exceed address changes");
+
+  tStartResult result = { (claiming == 0), (lastClaim - firstPowerUp), addressChanges, eepromWrites, maximumEepromWrites, saved };
+  return(result);
+}
+
+static bool parseUnsigned(const char *text, unsigned long &value) {
+  char *end;
+
+  value = strtoul(text, &end, 10);
+  return((*text != 0) && (*end == 0));
+}
+
+int main(int argc, char *argv[]) {
+  tOptions options = { 20, 20, 15, 120, 500, 30.0, 1000, 32, 40, 0, 0, 1 };
+  unsigned long value;
+
+  for (int a = 1; a < argc; a++) {
+    bool hasValue = ((a + 1) < argc);
+
+    if ((!hasValue) || (!parseUnsigned(argv[a + 1], value))) {
+      fprintf(stderr, "FleetSimulator: bad or missing value for '%s'\n", argv[a]);
+      return(EXIT_FAILURE);
+    }
+    if (strcmp(argv[a], "--sim") == 0) options.sim = value;
+    else if (strcmp(argv[a], "--rom") == 0) options.rom = value;
+    else if (strcmp(argv[a], "--tsm") == 0) options.tsm = value;
+    else if (strcmp(argv[a], "--duration") == 0) options.duration = value;
+    else if (strcmp(argv[a], "--start-jitter") == 0) options.startJitter = value;
+    else if (strcmp(argv[a], "--event-interval") == 0) options.eventInterval = value;
+    else if (strcmp(argv[a], "--loop-period") == 0) options.loopPeriod = value;
+    else if (strcmp(argv[a], "--rx-frames") == 0) options.rxFrames = value;
+    else if (strcmp(argv[a], "--tx-frames") == 0) options.txFrames = value;
+    else if (strcmp(argv[a], "--save-delay") == 0) options.saveDelay = value;
+    else if (strcmp(argv[a], "--device-unique-number") == 0) options.deviceUniqueNumber = value;
+    else if (strcmp(argv[a], "--seed") == 0) options.seed = value;
+    else {
+      fprintf(stderr, "FleetSimulator: unknown option '%s'\n", argv[a]);
+      return(EXIT_FAILURE);
+    }
+    a++;
+  }
+  if (((options.sim + options.rom + options.tsm) == 0) || (options.duration == 0) || (options.loopPeriod == 0) || (options.eventInterval <= 0.0) || (options.rxFrames == 0) || (options.txFrames == 0)) {
+    fprintf(stderr, "FleetSimulator: fleet, duration, loop period, event interval and queue depths must be non-zero\n");
+    return(EXIT_FAILURE);
+  }
+
+  tCanFrame probe = { 0x1cf00d16UL, 8, { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff }, 0, 0 };
+  unsigned int bits = canFrameBits(probe);
+  check((bits >= 131) && (bits <= 160), "an 8 byte extended frame is between 131 and 160 bits long");
+
+  for (unsigned int v = 0; v < VARIANT_COUNT; v++) {
+    check((Profiles[v]->busBitRate == Profiles[VARIANT_SIM]->busBitRate) && (Profiles[v]->busBitsPerFrame == Profiles[VARIANT_SIM]->busBitsPerFrame), "every module assumes the same bus");
+  }
+  check((Profiles[VARIANT_SIM]->transmitPeriod > 0) && (Profiles[VARIANT_ROM]->transmitPeriod > 0) && (Profiles[VARIANT_TSM]->temperatureChannelCount > 0), "the module profiles describe transmissions to simulate");
+
+  VirtualCanBus bus(Profiles[VARIANT_SIM]->busBitRate);
+  std::vector<SimulatedNode *> nodes;
+  std::mt19937_64 random(options.seed);
+  unsigned int counts[VARIANT_COUNT] = { options.sim, options.rom, options.tsm };
+  unsigned long serial = 0;
+  std::map<uint64_t, unsigned int> names;
+  bool uniqueNames;
+
+  for (unsigned int v = 0; v < VARIANT_COUNT; v++) {
+    for (unsigned int i = 0; i < counts[v]; i++) {
+      serial++;
+      nodes.push_back(new SimulatedNode(bus, (tVariant) v, i, serial, options));
+      names[nodes.back()->getName()]++;
+    }
+  }
+  uniqueNames = (names.size() == nodes.size());
+
+  printf("NOP100 fleet: %u SIM, %u ROM, %u TSM; %s NAMEs; EEPROM save %s", options.sim, options.rom, options.tsm, (uniqueNames)?"unique":"shared", (options.saveDelay == 0)?"immediate":"deferred");
+  if (options.saveDelay != 0) printf(" by %lu ms", options.saveDelay);
+  printf("; seed %lu\n", options.seed);
+
+  tStartResult cold = runStart("Cold", nodes, bus, 0, options, random);
+  tStartResult warm = runStart("Warm", nodes, bus, ((tSimTime) options.duration * 1000000ULL) + 5000000ULL, options, random);
+
+  if (uniqueNames) {
+    check(cold.converged && warm.converged, "a fleet with unique NAMEs converges");
+    check((!cold.saved) || ((warm.addressChanges == 0) && (warm.eepromWrites == 0)), "a warm start after a saved cold start changes no address and writes no EEPROM");
+    check(((options.saveDelay * 1000ULL) <= cold.settleTime) || (cold.maximumEepromWrites <= 1), "a save deferred past the claims writes each address at most once");
+  }
+
+  for (SimulatedNode *node : nodes) delete node;
+  printf("\n%s\n", (Failures == 0)?"PASS":"FAIL");
+  return((Failures == 0)?EXIT_SUCCESS:EXIT_FAILURE);
+}
@@ -0,0 +1,68 @@
+/**
+ * @file MIKROE5981FrameTest.cpp
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Host test of the MikroE 5981 frame decoder.
+ * @version 0.1
+ * @date 2024-08-05
+ * @copyright Copyright (c) 2024
+ *
+ * Each input is energised alone and then all but one are energised:
+ * the decoded bitmap must have exactly the corresponding bit clear or
+ * set, with IN1 in bit 0, whatever the content of the byte which does
+ * not carry channel state. Every status byte value must decode to
+ * itself and no bit above CHANNEL_COUNT may ever be set.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "../MIKROE5981Frame.h"
+
+static unsigned int Failures = 0;
+
+static void check(bool condition, const char *test, unsigned int channel, uint32_t value) {
+  if (!condition) Failures++;
+  printf("%s %s: IN%u decoded as 0x%02lx\n", (condition)?"PASS":"FAIL", test, channel, (unsigned long) value);
+}
+
+/**********************************************************************
+ * @brief Build a frame from a status byte, filling the other byte
+ * with a pattern that must be ignored.
+ */
+static void makeFrame(uint8_t *frame, uint8_t status, uint8_t other) {
+  for (unsigned int i = 0; i < MIKROE5981Frame::SIZE; i++) frame[i] = other;
+  frame[MIKROE5981Frame::STATUS_BYTE] = status;
+}
+
+int main() {
+  static const uint8_t others[] = { 0x00, 0xff, 0xa5 };
+  uint8_t frame[MIKROE5981Frame::SIZE];
+  uint32_t mask = ((1UL << MIKROE5981Frame::CHANNEL_COUNT) - 1);
+
+  for (unsigned int o = 0; o < (sizeof(others) / sizeof(others[0])); o++) {
+    for (unsigned int c = 0; c < MIKROE5981Frame::CHANNEL_COUNT; c++) {
+      uint32_t value;
+
+      makeFrame(frame, (uint8_t) (1U << c), others[o]);
+      value = MIKROE5981Frame::channels(frame);
+      check(value == (1UL << c), "single input", (c + 1), value);
+
+      makeFrame(frame, (uint8_t) ~(1U << c), others[o]);
+      value = MIKROE5981Frame::channels(frame);
+      check(value == (mask & ~(1UL << c)), "all but one input", (c + 1), value);
+    }
+  }
+
+  for (unsigned int status = 0; status < 256; status++) {
+    makeFrame(frame, (uint8_t) status, (uint8_t) ~status);
+    uint32_t value = MIKROE5981Frame::channels(frame);
+    if ((value != status) || (value & ~mask)) {
+      Failures++;
+      printf("FAIL status byte 0x%02x decoded as 0x%02lx\n", status, (unsigned long) value);
+    }
+  }
+
+  printf("%u failure(s)\n", Failures);
+  return((Failures == 0)?EXIT_SUCCESS:EXIT_FAILURE);
+}
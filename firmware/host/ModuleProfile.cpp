@@ -0,0 +1,91 @@
+/**
+ * @file ModuleProfile.cpp
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Host build of NOP100.cpp for one module and export of its
+ * profile (see ModuleProfile.h).
+ * @version 0.1
+ * @date 2024-09-20
+ * @copyright Copyright (c) 2024
+ *
+ * Build with -DNOP100_MODULE=NOP100-<M> -DMODULE_PROFILE=<M> and the
+ * stubs/ folder on the include path. Every library header NOP100
+ * uses is included here first, so that its include guard keeps it
+ * out of the module namespace.
+ */
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <NMEA2000.h>
+#include <N2kTypes.h>
+#include <N2kMessages.h>
+#include <NMEA2000_Teensyx.h>
+#include <NMEA2000_CAN.h>
+#include <Button.h>
+#include <IC74HC165.h>
+#include <SPI.h>
+#include <Wire.h>
+#include <EventResponder.h>
+#include <i2c_driver.h>
+#include <i2c_driver_wire.h>
+#include <imx_rt1060/imx_rt1060_i2c_driver.h>
+#include <LedManager.h>
+#include <ModuleOperatorInterface.h>
+#include <ModuleConfiguration.h>
+#include <FunctionMapper.h>
+#include <arraymacros.h>
+#include "ModuleProfile.h"
+
+#define MODULE_PROFILE_PASTE_(a, b) a##b
+#define MODULE_PROFILE_PASTE(a, b) MODULE_PROFILE_PASTE_(a, b)
+#define MODULE_PROFILE_NAMESPACE MODULE_PROFILE_PASTE(NOP100_, MODULE_PROFILE)
+#define MODULE_PROFILE_NAME MODULE_PROFILE_PASTE(ModuleProfile_, MODULE_PROFILE)
+
+namespace MODULE_PROFILE_NAMESPACE {
+#include <NOP100.cpp>
+}
+
+namespace {
+
+  using namespace MODULE_PROFILE_NAMESPACE;
+
+  template <class M>
+  class tFirmwareBusLoad : public tBusLoadEstimate {
+    public:
+      void count(unsigned int frames) { this->monitor.count(frames); }
+      bool update(unsigned long now) { return(this->monitor.update(now)); }
+      unsigned long stretch(unsigned long period) { return(this->monitor.stretch(period)); }
+      unsigned int getStretch() { return(this->monitor.getStretch()); }
+      unsigned int getPeakLoad() { return(this->monitor.getPeakLoad()); }
+    private:
+      M monitor;
+  };
+
+  tBusLoadEstimate *createBusLoad() {
+    return(new tFirmwareBusLoad<decltype(BusLoad)>());
+  }
+
+  constexpr bool HasScheduler = (manifestSchedulerCount(ModuleManifest::Schedulers) > 0);
+
+}
+
+extern const tModuleProfile MODULE_PROFILE_NAME = {
+  PRODUCT_TYPE,
+  DEVICE_CLASS,
+  DEVICE_FUNCTION,
+  DEVICE_INDUSTRY_GROUP,
+  DEVICE_MANUFACTURER_CODE,
+  DEVICE_UNIQUE_NUMBER,
+  ModuleManifest::Configuration[MODULE_CONFIGURATION_CAN_SOURCE_INDEX].defaultValue,
+  BUS_LOAD_BIT_RATE,
+  BUS_LOAD_BITS_PER_FRAME,
+  createBusLoad,
+  (HasScheduler)?(ModuleManifest::Configuration[ModuleManifest::Schedulers[0].periodIndex].defaultValue * ModuleManifest::Schedulers[0].periodUnit):0UL,
+  (HasScheduler)?(ModuleManifest::Configuration[ModuleManifest::Schedulers[0].offsetIndex].defaultValue * ModuleManifest::Schedulers[0].offsetUnit):0UL,
+  #ifdef TEMPERATURE_CHANNEL_COUNT
+  TEMPERATURE_CHANNEL_COUNT,
+  (ModuleManifest::Configuration[MODULE_CONFIGURATION_PGN130316_HEARTBEAT_PERIOD_INDEX].defaultValue * PGN130316_HEARTBEAT_PERIOD_UNIT),
+  (ModuleManifest::Configuration[MODULE_CONFIGURATION_PGN130316_HOLDOFF_INDEX].defaultValue * PGN130316_HOLDOFF_UNIT)
+  #else
+  0, 0UL, 0UL
+  #endif
+};
@@ -0,0 +1,62 @@
+/**
+ * @file ModuleProfile.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief What the fleet simulator knows about a NOP100 module, taken
+ * from the module's own files.
+ * @version 0.1
+ * @date 2024-09-20
+ * @copyright Copyright (c) 2024
+ *
+ * ModuleProfile.cpp is compiled once for each module with
+ * NOP100_MODULE and MODULE_PROFILE set. Each compilation builds
+ * NOP100.cpp, and through it the module's defines.h, manifest.h and
+ * definitions.h, against the library stubs in stubs/, inside a
+ * namespace of its own. It then exports a tModuleProfile whose values
+ * come from the module's macros and manifest, and a BusLoad.h monitor
+ * of the type NOP100.cpp creates. Nothing in the firmware is run.
+ */
+
+#ifndef MODULEPROFILE_H
+#define MODULEPROFILE_H
+
+/**********************************************************************
+ * @brief A module's BusLoad.h monitor behind a common interface.
+ */
+class tBusLoadEstimate {
+  public:
+    virtual ~tBusLoadEstimate() {}
+    virtual void count(unsigned int frames) = 0;
+    virtual bool update(unsigned long now) = 0;
+    virtual unsigned long stretch(unsigned long period) = 0;
+    virtual unsigned int getStretch() = 0;
+    virtual unsigned int getPeakLoad() = 0;
+};
+
+/**********************************************************************
+ * @brief Module parameters. Times are in milliseconds; a module
+ * without periodic transmissions or temperature channels has zero in
+ * the corresponding fields.
+ */
+struct tModuleProfile {
+  const char *productType;
+  unsigned char deviceClass;
+  unsigned char deviceFunction;
+  unsigned char deviceIndustryGroup;
+  unsigned int deviceManufacturerCode;
+  unsigned long deviceUniqueNumber;     // Zero: from the Teensy serial number
+  unsigned char canSourceDefault;
+  unsigned long busBitRate;
+  unsigned int busBitsPerFrame;
+  tBusLoadEstimate *(*createBusLoad)();
+  unsigned long transmitPeriod;         // First scheduler in the manifest
+  unsigned long transmitOffset;
+  unsigned int temperatureChannelCount;
+  unsigned long temperatureHeartbeatPeriod;
+  unsigned long temperatureHoldoff;
+};
+
+extern const tModuleProfile ModuleProfile_SIM;
+extern const tModuleProfile ModuleProfile_ROM;
+extern const tModuleProfile ModuleProfile_TSM;
+
+#endif
@@ -0,0 +1,411 @@
+/**
+ * @file VirtualCanBus.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Virtual CAN bus and stub CAN driver for host simulation of a
+ * fleet of NOP100 modules.
+ * @version 0.1
+ * @date 2024-09-20
+ * @copyright Copyright (c) 2024
+ *
+ * VirtualCanDriver stands in for the Teensy CAN driver beneath the
+ * NMEA2000 library. Its CANOpen(), CANSendFrame() and CANGetFrame()
+ * methods have the signatures of the driver hooks which tNMEA2000
+ * declares, and it keeps the bounded transmit and receive frame queues
+ * and the transmit error counter of a CAN controller.
+ *
+ * VirtualCanBus carries frames between the drivers attached to it in
+ * simulated time (microseconds):
+ *
+ * - When the bus is idle every driver with a queued frame contends and
+ *   the lowest identifier wins arbitration.
+ * - A frame occupies the bus for its exact length in bits, including
+ *   stuff bits computed over the real CRC, the ACK field, end of frame
+ *   and intermission.
+ * - Contenders with the same identifier and the same data are
+ *   indistinguishable on the wire: the frame is sent once and every
+ *   contender sees it succeed. Where the data differ, a contender
+ *   which sends a recessive bit and reads back a dominant one sees a
+ *   bit error. If it is error active its error flag destroys the frame
+ *   and every contender adds 8 to its transmit error counter and
+ *   retries; if it is error passive (counter of 128 or more) its flag
+ *   is recessive, the frame completes and only the loser is
+ *   penalised. An error passive controller waits a further 8 bit times
+ *   after transmitting, and one whose counter reaches 256 goes bus-off
+ *   for 128 x 11 bit times. The length of an error frame is
+ *   approximated from the position of the first differing bit.
+ * - A controller does not receive frames which it sent itself.
+ *
+ * Receive errors and acknowledgement errors are not modelled.
+ */
+
+#ifndef VIRTUALCANBUS_H
+#define VIRTUALCANBUS_H
+
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include <deque>
+#include <functional>
+#include <vector>
+
+typedef uint64_t tSimTime;
+
+static const tSimTime SIM_TIME_NEVER = UINT64_MAX;
+
+struct tCanFrame {
+  unsigned long id;
+  unsigned char len;
+  unsigned char data[8];
+  tSimTime queuedAt;                    // Simulation bookkeeping,
+  unsigned int tag;                     // not carried on the wire
+};
+
+/**********************************************************************
+ * @brief Get the length on the wire of an extended data frame, in
+ * bits, including stuff bits and the three bit intermission.
+ */
+static inline unsigned int canFrameBits(const tCanFrame &frame) {
+  uint8_t bits[128];
+  unsigned int count = 0;
+  unsigned int total = 0;
+  unsigned int run = 0;
+  int last = -1;
+  uint16_t crc = 0;
+
+  auto put = [&](uint32_t value, unsigned int width) {
+    for (int b = (width - 1); b >= 0; b--) bits[count++] = ((value >> b) & 1);
+  };
+
+  put(0, 1);                            // SOF
+  put((frame.id >> 18) & 0x7ff, 11);    // Base identifier
+  put(3, 2);                            // SRR, IDE
+  put(frame.id & 0x3ffff, 18);          // Identifier extension
+  put(0, 3);                            // RTR, r1, r0
+  put(frame.len, 4);
+  for (unsigned int i = 0; i < frame.len; i++) put(frame.data[i], 8);
+  for (unsigned int i = 0; i < count; i++) {
+    bool feedback = (bits[i] ^ ((crc >> 14) & 1));
+    crc = ((crc << 1) & 0x7fff);
+    if (feedback) crc ^= 0x4599;
+  }
+  put(crc, 15);
+
+  for (unsigned int i = 0; i < count; i++) {
+    total++;
+    if (bits[i] == last) run++; else { last = bits[i]; run = 1; }
+    if (run == 5) {
+      total++;
+      last = !last;
+      run = 1;
+    }
+  }
+  return(total + 1 + 2 + 7 + 3);        // CRC delimiter, ACK, EOF, intermission
+}
+
+class VirtualCanBus;
+
+/**********************************************************************
+ * @brief Stub CAN driver with the tNMEA2000 driver hook signatures.
+ */
+class VirtualCanDriver {
+  friend class VirtualCanBus;
+
+  public:
+    VirtualCanDriver(VirtualCanBus &bus, unsigned int txSize, unsigned int rxSize) : bus(bus), txSize(txSize), rxSize(rxSize), open(false), tec(0), busOff(false), readyAt(0), tag(0), txRefused(0), rxOverflows(0), rxHighWater(0), busOffCount(0) {}
+
+    bool CANOpen();
+
+    /******************************************************************
+     * @brief Queue a frame for transmission. The transmit queue is
+     * always sent in order, so wait_sent, which asks the library's
+     * drivers to keep a frame behind those already queued, has no
+     * effect.
+     */
+    bool CANSendFrame(unsigned long id, unsigned char len, const unsigned char *buf, bool wait_sent = true);
+
+    bool CANGetFrame(unsigned long &id, unsigned char &len, unsigned char *buf) {
+      if (this->rx.empty()) return(false);
+      id = this->rx.front().id;
+      len = this->rx.front().len;
+      memcpy(buf, this->rx.front().data, len);
+      this->rx.pop_front();
+      return(true);
+    }
+
+    /******************************************************************
+     * @brief Power cycle the controller: close it, empty its queues and
+     * clear its error state and statistics.
+     */
+    void reset() {
+      this->open = false;
+      this->tec = 0;
+      this->busOff = false;
+      this->readyAt = 0;
+      this->tx.clear();
+      this->rx.clear();
+      this->txRefused = 0;
+      this->rxOverflows = 0;
+      this->rxHighWater = 0;
+      this->busOffCount = 0;
+    }
+
+    /******************************************************************
+     * @brief Set the tag recorded with subsequently queued frames.
+     */
+    void setTag(unsigned int tag) { this->tag = tag; }
+
+    unsigned long getTxRefused() const { return(this->txRefused); }
+    unsigned long getRxOverflows() const { return(this->rxOverflows); }
+    size_t getRxHighWater() const { return(this->rxHighWater); }
+    unsigned long getBusOffCount() const { return(this->busOffCount); }
+
+  private:
+    VirtualCanBus &bus;
+    unsigned int txSize;
+    unsigned int rxSize;
+    bool open;
+    unsigned int tec;
+    bool busOff;
+    tSimTime readyAt;
+    unsigned int tag;
+    std::deque<tCanFrame> tx;
+    std::deque<tCanFrame> rx;
+    unsigned long txRefused;
+    unsigned long rxOverflows;
+    size_t rxHighWater;
+    unsigned long busOffCount;
+};
+
+/**********************************************************************
+ * @brief Virtual CAN bus.
+ */
+class VirtualCanBus {
+  public:
+    /******************************************************************
+     * @brief Function called for each frame successfully sent, with
+     * the frame, the time its transmission started and ended and the
+     * number of controllers which sent it.
+     */
+    typedef std::function<void(const tCanFrame &frame, tSimTime started, tSimTime ended, unsigned int senders)> tFrameListener;
+
+    VirtualCanBus(unsigned long bitRate) : bitTime(1000000.0 / bitRate), now(0), busy(false), frameEnd(0), errorFrame(false), busyTime(0), frames(0), errorFrames(0), mergedFrames(0) {}
+
+    void attach(VirtualCanDriver *driver) { this->drivers.push_back(driver); }
+    void setListener(tFrameListener listener) { this->listener = listener; }
+
+    tSimTime getTime() const { return(this->now); }
+
+    /******************************************************************
+     * @brief Get the time of the next bus event: the end of the frame
+     * on the bus or the time at which a waiting controller may next
+     * contend.
+     */
+    tSimTime nextEvent() const {
+      tSimTime next = SIM_TIME_NEVER;
+
+      if (this->busy) return(this->frameEnd);
+      for (const VirtualCanDriver *driver : this->drivers) {
+        if ((driver->open) && (!driver->tx.empty()) && (driver->readyAt > this->now) && (driver->readyAt < next)) next = driver->readyAt;
+      }
+      return(next);
+    }
+
+    /******************************************************************
+     * @brief Advance the bus to a given time, completing the frame on
+     * the bus if it has ended and starting the next if the bus is then
+     * idle.
+     */
+    void advance(tSimTime now) {
+      this->now = now;
+      if ((this->busy) && (now >= this->frameEnd)) this->finish();
+      if (!this->busy) this->arbitrate();
+    }
+
+    /******************************************************************
+     * @brief Abandon the frame in progress, as when the whole bus loses
+     * power.
+     */
+    void reset() {
+      this->busy = false;
+      this->contenders.clear();
+      this->senders.clear();
+      this->losers.clear();
+    }
+
+    tSimTime getBusyTime() const { return(this->busyTime); }
+    unsigned long getFrames() const { return(this->frames); }
+    unsigned long getErrorFrames() const { return(this->errorFrames); }
+    unsigned long getMergedFrames() const { return(this->mergedFrames); }
+
+  private:
+    double bitTime;
+    tSimTime now;
+    std::vector<VirtualCanDriver *> drivers;
+    std::vector<VirtualCanDriver *> contenders;
+    std::vector<VirtualCanDriver *> senders;
+    std::vector<VirtualCanDriver *> losers;
+    tFrameListener listener;
+    bool busy;
+    tSimTime frameStart;
+    tSimTime frameEnd;
+    bool errorFrame;
+    tSimTime busyTime;
+    unsigned long frames;
+    unsigned long errorFrames;
+    unsigned long mergedFrames;
+
+    tSimTime bits(unsigned int count) const { return((tSimTime) ((count * this->bitTime) + 0.5)); }
+
+    /******************************************************************
+     * @brief Compare the data fields of two frames as they appear on
+     * the wire.
+     *
+     * @return the position of the first differing bit counted from
+     * SOF, or 0 if the fields are identical; dominant is set true if
+     * a carries the dominant (zero) bit there.
+     */
+    static unsigned int compare(const tCanFrame &a, const tCanFrame &b, bool &dominant) {
+      if (a.len != b.len) {
+        dominant = (a.len < b.len);
+        return(35 + __builtin_clz((unsigned int) (a.len ^ b.len)) - 28);
+      }
+      for (unsigned int i = 0; i < a.len; i++) {
+        if (a.data[i] != b.data[i]) {
+          dominant = (a.data[i] < b.data[i]);
+          return(39 + (i * 8) + __builtin_clz((unsigned int) (uint8_t) (a.data[i] ^ b.data[i])) - 24);
+        }
+      }
+      return(0);
+    }
+
+    /******************************************************************
+     * @brief Start the next frame. Among contenders with the lowest
+     * identifier the frame with the dominant bit at the first point of
+     * difference is the one on the wire; every other contender sees a
+     * bit error there. An error active loser destroys the frame with an
+     * error flag; an error passive loser's flag is recessive, so the
+     * frame completes and only the loser is penalised.
+     */
+    void arbitrate() {
+      unsigned long lowest = ULONG_MAX;
+      VirtualCanDriver *winner;
+      bool dominant;
+      unsigned int differAt = 0;
+
+      this->contenders.clear();
+      this->senders.clear();
+      this->losers.clear();
+      for (VirtualCanDriver *driver : this->drivers) {
+        if ((!driver->open) || (driver->tx.empty()) || (driver->readyAt > this->now)) continue;
+        if (driver->busOff) {
+          driver->busOff = false;
+          driver->tec = 0;
+        }
+        if (driver->tx.front().id < lowest) {
+          lowest = driver->tx.front().id;
+          this->contenders.clear();
+        }
+        if (driver->tx.front().id == lowest) this->contenders.push_back(driver);
+      }
+      if (this->contenders.empty()) return;
+
+      winner = this->contenders[0];
+      for (VirtualCanDriver *driver : this->contenders) {
+        if ((compare(driver->tx.front(), winner->tx.front(), dominant) != 0) && (dominant)) winner = driver;
+      }
+      this->errorFrame = false;
+      for (VirtualCanDriver *driver : this->contenders) {
+        unsigned int bit = compare(driver->tx.front(), winner->tx.front(), dominant);
+
+        if (bit == 0) {
+          this->senders.push_back(driver);
+        } else {
+          this->losers.push_back(driver);
+          if ((differAt == 0) || (bit < differAt)) differAt = bit;
+          if (driver->tec < 128) this->errorFrame = true;
+        }
+      }
+
+      this->busy = true;
+      this->frameStart = this->now;
+      if (this->errorFrame) {
+        // Stuffed prefix to the error, error flag, echo and delimiter
+        // and intermission.
+        this->frameEnd = (this->now + this->bits(differAt + (differAt / 5) + 6 + 6 + 8 + 3));
+      } else {
+        this->frameEnd = (this->now + this->bits(canFrameBits(winner->tx.front())));
+      }
+    }
+
+    /******************************************************************
+     * @brief Add a transmit error to a controller's error counter.
+     */
+    void penalise(VirtualCanDriver *driver) {
+      driver->tec += 8;
+      if (driver->tec >= 256) {
+        driver->busOff = true;
+        driver->busOffCount++;
+        driver->readyAt = (this->frameEnd + this->bits(128 * 11));
+      } else if (driver->tec >= 128) {
+        driver->readyAt = (this->frameEnd + this->bits(8));
+      }
+    }
+
+    void finish() {
+      this->busy = false;
+      this->busyTime += (this->frameEnd - this->frameStart);
+
+      if (this->errorFrame) {
+        this->errorFrames++;
+        for (VirtualCanDriver *driver : this->contenders) this->penalise(driver);
+        return;
+      }
+      for (VirtualCanDriver *driver : this->losers) this->penalise(driver);
+
+      tCanFrame frame = this->senders[0]->tx.front();
+
+      this->frames++;
+      if (this->senders.size() > 1) this->mergedFrames++;
+      for (VirtualCanDriver *driver : this->drivers) {
+        bool sender = false;
+
+        for (VirtualCanDriver *contender : this->senders) sender = (sender || (contender == driver));
+        if ((!driver->open) || (driver->busOff) || (sender)) continue;
+        if (driver->rx.size() >= driver->rxSize) {
+          driver->rxOverflows++;
+          continue;
+        }
+        driver->rx.push_back(frame);
+        if (driver->rx.size() > driver->rxHighWater) driver->rxHighWater = driver->rx.size();
+      }
+      for (VirtualCanDriver *driver : this->senders) {
+        if (this->listener) this->listener(driver->tx.front(), this->frameStart, this->frameEnd, this->senders.size());
+        driver->tx.pop_front();
+        if (driver->tec > 0) driver->tec--;
+        if (driver->tec >= 128) driver->readyAt = (this->frameEnd + this->bits(8));
+      }
+    }
+};
+
+inline bool VirtualCanDriver::CANOpen() {
+  this->open = true;
+  return(true);
+}
+
+inline bool VirtualCanDriver::CANSendFrame(unsigned long id, unsigned char len, const unsigned char *buf, bool /* wait_sent */) {
+  tCanFrame frame;
+
+  if ((!this->open) || (this->tx.size() >= this->txSize)) {
+    this->txRefused++;
+    return(false);
+  }
+  frame.id = id;
+  frame.len = len;
+  memcpy(frame.data, buf, len);
+  frame.queuedAt = this->bus.getTime();
+  frame.tag = this->tag;
+  this->tx.push_back(frame);
+  return(true);
+}
+
+#endif
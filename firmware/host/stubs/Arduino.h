@@ -0,0 +1,94 @@
+/**
+ * @file Arduino.h
+ * @brief Host stub of the Teensy core for the host build of NOP100.
+ *
+ * Just enough of the core for NOP100.cpp and its module files to
+ * compile and link on the build host. Nothing here is meant to run:
+ * time stands still and pins read low.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define RISING 3
+#define FALLING 4
+#define CHANGE 5
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define BIN 2
+#define HEX 16
+#define PROGMEM
+
+inline unsigned long millis() { return(0); }
+inline unsigned long micros() { return(0); }
+inline void delay(unsigned long) {}
+inline void delayMicroseconds(unsigned int) {}
+inline void pinMode(int, int) {}
+inline void digitalWrite(int, int) {}
+inline void digitalWriteFast(uint8_t, uint8_t) {}
+inline int digitalRead(int) { return(LOW); }
+inline int analogRead(int) { return(0); }
+inline void analogWrite(int, int) {}
+inline void analogWriteFrequency(int, float) {}
+inline int digitalPinToInterrupt(int pin) { return(pin); }
+inline void attachInterrupt(int, void (*)(), int) {}
+inline void detachInterrupt(int) {}
+inline void noInterrupts() {}
+inline void interrupts() {}
+inline void __disable_irq() {}
+inline void __enable_irq() {}
+
+template <class T> T min(T a, T b) { return((a < b)?a:b); }
+template <class T> T max(T a, T b) { return((a > b)?a:b); }
+typedef bool boolean;
+
+struct HardwareSerial {
+  void begin(unsigned long) {}
+  template <class T> void print(T) {}
+  template <class T> void print(T, int) {}
+  template <class T> void println(T) {}
+  template <class T> void println(T, int) {}
+  void println() {}
+};
+inline HardwareSerial Serial;
+
+class EventResponder {
+  public:
+    void attach(void (*)(EventResponder &)) {}
+    void attachImmediate(void (*)(EventResponder &)) {}
+    void setContext(void *context) { this->context = context; }
+    void *getContext() { return(this->context); }
+    void clearEvent() {}
+    void triggerEvent(int = 0, void * = 0) {}
+  private:
+    void *context = 0;
+};
+
+class IntervalTimer {
+  public:
+    bool begin(void (*)(), unsigned long) { return(true); }
+    void end() {}
+    void priority(int) {}
+    void update(unsigned long) {}
+};
+
+inline volatile uint32_t ARM_DWT_CYCCNT;
+inline volatile uint32_t ARM_DEMCR;
+inline volatile uint32_t ARM_DWT_CTRL;
+#define ARM_DEMCR_TRCENA (1 << 24)
+#define ARM_DWT_CTRL_CYCCNTENA (1 << 0)
+inline uint32_t F_CPU_ACTUAL = 600000000;
+
+inline volatile uint32_t HW_OCOTP_MAC0;
@@ -0,0 +1,20 @@
+/**
+ * @file Button.h
+ * @brief Host stub of the Button library: a button never pressed.
+ */
+
+#pragma once
+
+class Button {
+  public:
+    static const bool PRESSED = 0;
+    static const bool RELEASED = 1;
+
+    Button(int, unsigned long = 100) {}
+    void begin() {}
+    bool read() { return(RELEASED); }
+    bool toggled() { return(false); }
+    bool pressed() { return(false); }
+    bool released() { return(false); }
+    bool has_changed() { return(false); }
+};
@@ -0,0 +1,17 @@
+/**
+ * @file EEPROM.h
+ * @brief Host stub of the Teensy EEPROM library: erased EEPROM which
+ * ignores writes.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+struct EEPROMClass {
+  uint8_t read(int) { return(0xff); }
+  void write(int, uint8_t) {}
+  void update(int, uint8_t) {}
+  int length() { return(1080); }
+};
+inline EEPROMClass EEPROM;
@@ -0,0 +1,8 @@
+/**
+ * @file EventResponder.h
+ * @brief Host stub: EventResponder is declared by the Arduino.h stub.
+ */
+
+#pragma once
+
+#include <Arduino.h>
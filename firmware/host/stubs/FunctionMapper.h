@@ -0,0 +1,17 @@
+/**
+ * @file FunctionMapper.h
+ * @brief Host stub of the FunctionMapper library.
+ */
+
+#pragma once
+
+#include "ModuleOperatorInterface.h"
+
+class FunctionMapper : public ModuleOperatorInterfaceClient {
+  public:
+    typedef struct { unsigned char functionCode; bool (*handler)(unsigned char, unsigned char); } FunctionMap;
+
+    FunctionMapper(FunctionMap *, unsigned int) {}
+    bool validateAddress(unsigned int) { return(false); }
+    bool processValue(unsigned int, unsigned char) { return(false); }
+};
@@ -0,0 +1,15 @@
+/**
+ * @file IC74HC165.h
+ * @brief Host stub of the IC74HC165 shift register library.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+class IC74HC165 {
+  public:
+    IC74HC165(uint8_t, uint8_t, uint8_t, unsigned int = 1) {}
+    void begin() {}
+    unsigned int read(unsigned int = 0) { return(0); }
+};
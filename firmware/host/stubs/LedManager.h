@@ -0,0 +1,17 @@
+/**
+ * @file LedManager.h
+ * @brief Host stub of the LedManager library.
+ */
+
+#pragma once
+
+class LedManager {
+  public:
+    enum tLedState { OFF, ON, ONCE, TWICE, THRICE, FLASH };
+
+    LedManager(void (*)(unsigned int), unsigned long, unsigned int = 1) {}
+    void setStatus(unsigned int) {}
+    void setLedState(unsigned int, tLedState) {}
+    void update() {}
+    void update(bool) {}
+};
@@ -0,0 +1,27 @@
+/**
+ * @file ModuleConfiguration.h
+ * @brief Host stub of the ModuleConfiguration library: a configuration
+ * which holds its defaults.
+ *
+ * NOP100.cpp names its object after the class, as the library allows,
+ * so the stub class is renamed through the preprocessor.
+ */
+
+#pragma once
+
+#include "ModuleOperatorInterface.h"
+
+class tModuleConfiguration : public ModuleOperatorInterfaceClient {
+  public:
+    tModuleConfiguration(unsigned char *defaults, unsigned int size, unsigned int, bool (*)(unsigned int, unsigned char)) : defaults(defaults), size(size) {}
+    bool validateAddress(unsigned int index) { return(index < this->size); }
+    bool processValue(unsigned int, unsigned char) { return(false); }
+    unsigned char getByte(unsigned int index) { return((index < this->size)?this->defaults[index]:0); }
+    bool setByte(unsigned int, unsigned char) { return(false); }
+    void erase() {}
+    unsigned int getSize() { return(this->size); }
+  private:
+    const unsigned char *defaults;
+    unsigned int size;
+};
+#define ModuleConfiguration tModuleConfiguration
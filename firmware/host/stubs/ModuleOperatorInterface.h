@@ -0,0 +1,22 @@
+/**
+ * @file ModuleOperatorInterface.h
+ * @brief Host stub of the ModuleOperatorInterface library.
+ */
+
+#pragma once
+
+class ModuleOperatorInterfaceClient {
+  public:
+    virtual ~ModuleOperatorInterfaceClient() {}
+    virtual bool validateAddress(unsigned int) = 0;
+    virtual bool processValue(unsigned int, unsigned char) = 0;
+};
+
+class ModuleOperatorInterface {
+  public:
+    enum EventOutcome { MODE_CHANGE, ADDRESS_ACCEPTED, ADDRESS_REJECTED, VALUE_ACCEPTED, VALUE_REJECTED };
+
+    ModuleOperatorInterface(ModuleOperatorInterfaceClient **) {}
+    EventOutcome handleButtonEvent(bool, unsigned char) { return(VALUE_REJECTED); }
+    void revertModeMaybe() {}
+};
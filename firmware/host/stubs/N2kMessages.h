@@ -0,0 +1,27 @@
+/**
+ * @file N2kMessages.h
+ * @brief Host stub of the NMEA2000 library message builders and
+ * parsers used by NOP100: nothing is built and nothing parses.
+ */
+
+#pragma once
+
+#include "N2kMsg.h"
+#include "N2kTypes.h"
+
+#define N2kDoubleNA -1e9
+#define N2kInt8NA 127
+
+inline void SetN2kPGN127501(tN2kMsg &, unsigned char, tN2kBinaryStatus) {}
+inline bool ParseN2kPGN127501(const tN2kMsg &, unsigned char &, tN2kBinaryStatus &) { return(false); }
+inline bool ParseN2kPGN127502(const tN2kMsg &, unsigned char &, tN2kBinaryStatus &) { return(false); }
+inline tN2kOnOff N2kGetStatusOnBinaryStatus(tN2kBinaryStatus, uint8_t) { return(N2kOnOff_Unavailable); }
+inline void N2kSetStatusBinaryOnStatus(tN2kBinaryStatus &, tN2kOnOff, uint8_t) {}
+inline void N2kResetBinaryStatus(tN2kBinaryStatus &status) { status = 0xffffffffffffffffULL; }
+inline void SetN2kPGN130316(tN2kMsg &, unsigned char, unsigned char, tN2kTempSource, double, double = N2kDoubleNA) {}
+inline void SetN2kPGN127505(tN2kMsg &, unsigned char, tN2kFluidType, double, double) {}
+inline void SetN2kPGN127508(tN2kMsg &, unsigned char, double, double = N2kDoubleNA, double = N2kDoubleNA, unsigned char = 0xff) {}
+inline void SetN2kPGN127488(tN2kMsg &, unsigned char, double, double = N2kDoubleNA, int8_t = N2kInt8NA) {}
+inline void SetN2kPGN127497(tN2kMsg &, unsigned char, double, double, double, double) {}
+inline double KelvinToC(double kelvin) { return(kelvin - 273.15); }
+inline double CToKelvin(double celsius) { return(celsius + 273.15); }
@@ -0,0 +1,19 @@
+/**
+ * @file N2kMsg.h
+ * @brief Host stub of the NMEA2000 library message class.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+class tN2kMsg {
+  public:
+    unsigned long PGN = 0;
+    unsigned char Priority = 6;
+    unsigned char Source = 0;
+    unsigned char Destination = 0xff;
+    int DataLen = 0;
+    unsigned char Data[223] = {};
+    unsigned long MsgTime = 0;
+};
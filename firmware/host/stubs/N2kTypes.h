@@ -0,0 +1,14 @@
+/**
+ * @file N2kTypes.h
+ * @brief Host stub of the NMEA2000 library types used by NOP100.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+enum tN2kOnOff { N2kOnOff_Off = 0, N2kOnOff_On = 1, N2kOnOff_Error = 2, N2kOnOff_Unavailable = 3 };
+typedef uint64_t tN2kBinaryStatus;
+enum tN2kTempSource { N2kts_SeaTemperature = 0, N2kts_OutsideTemperature = 1, N2kts_InsideTemperature = 2, N2kts_EngineRoomTemperature = 3, N2kts_MainCabinTemperature = 4 };
+enum tN2kFluidType { N2kft_Fuel = 0, N2kft_Water = 1 };
+enum tN2kDCType { N2kDCt_Battery = 0, N2kDCt_Alternator = 1 };
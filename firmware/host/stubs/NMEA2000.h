@@ -0,0 +1,49 @@
+/**
+ * @file NMEA2000.h
+ * @brief Host stub of the NMEA2000 library: a node which never opens.
+ */
+
+#pragma once
+
+#include "N2kMsg.h"
+
+class tN2kSyncScheduler {
+  public:
+    tN2kSyncScheduler(bool = false, uint32_t period = 0, uint32_t offset = 0) : period(period), offset(offset) {}
+    void SetPeriodAndOffset(uint32_t period, uint32_t offset) { this->period = period; this->offset = offset; }
+    void SetPeriod(uint32_t period) { this->period = period; }
+    void SetOffset(uint32_t offset) { this->offset = offset; }
+    uint32_t GetPeriod() const { return(this->period); }
+    uint32_t GetOffset() const { return(this->offset); }
+    bool IsTime() { return(false); }
+    void UpdateNextTime() {}
+    void Disable() { this->period = 0; }
+    bool IsDisabled() const { return(this->period == 0); }
+  private:
+    uint32_t period;
+    uint32_t offset;
+};
+
+class tNMEA2000 {
+  public:
+    enum tN2kMode { N2km_ListenOnly = 0, N2km_NodeOnly = 1, N2km_ListenAndNode = 2 };
+
+    void SetProductInformation(const char *, unsigned short, const char *, const char *, const char *, unsigned char = 0xff, unsigned short = 0xffff, unsigned char = 0xff, int = 0) {}
+    void SetDeviceInformation(unsigned long, unsigned char, unsigned char, unsigned short, unsigned char = 4, int = 0) {}
+    void SetMode(tN2kMode, unsigned char source = 15) { this->source = source; }
+    void SetN2kSource(unsigned char source) { this->source = source; }
+    unsigned char GetN2kSource(int = 0) const { return(this->source); }
+    void EnableForward(bool = true) {}
+    void ExtendTransmitMessages(const unsigned long *, int = 0) {}
+    void SetMsgHandler(void (*)(const tN2kMsg &)) {}
+    void SetOnOpen(void (*)()) {}
+    void SetN2kCANMsgBufSize(unsigned char) {}
+    void SetN2kCANReceiveFrameBufSize(uint16_t) {}
+    void SetN2kCANSendFrameBufSize(uint16_t) {}
+    bool Open() { return(false); }
+    void ParseMessages() {}
+    bool ReadResetAddressChanged() { return(false); }
+    bool SendMsg(const tN2kMsg &, int = -1) { return(false); }
+  private:
+    unsigned char source = 0;
+};
@@ -0,0 +1,11 @@
+/**
+ * @file NMEA2000_CAN.h
+ * @brief Host stub of the NMEA2000 library's board selection, which
+ * creates the NMEA2000 object.
+ */
+
+#pragma once
+
+#include "NMEA2000.h"
+
+inline tNMEA2000 NMEA2000;
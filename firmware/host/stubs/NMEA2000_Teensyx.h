@@ -0,0 +1,8 @@
+/**
+ * @file NMEA2000_Teensyx.h
+ * @brief Host stub of the Teensy 4 CAN driver for the NMEA2000 library.
+ */
+
+#pragma once
+
+#include "NMEA2000.h"
@@ -0,0 +1,27 @@
+/**
+ * @file SPI.h
+ * @brief Host stub of the Teensy SPI library.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#define MSBFIRST 1
+#define SPI_MODE0 0
+#define SPI_MODE1 1
+
+struct SPISettings {
+  SPISettings() {}
+  SPISettings(uint32_t, int, int) {}
+};
+
+struct SPIClass {
+  void begin() {}
+  void beginTransaction(SPISettings) {}
+  void endTransaction() {}
+  uint8_t transfer(uint8_t) { return(0); }
+  void transfer(void *, size_t) {}
+  bool transfer(const void *, void *, size_t, EventResponder &) { return(true); }
+};
+inline SPIClass SPI;
@@ -0,0 +1,21 @@
+/**
+ * @file Wire.h
+ * @brief Host stub of the Arduino Wire library.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct TwoWire {
+  void begin() {}
+  void setClock(uint32_t) {}
+  void beginTransmission(uint8_t) {}
+  uint8_t endTransmission(bool = true) { return(0); }
+  size_t write(uint8_t) { return(1); }
+  uint8_t requestFrom(uint8_t, uint8_t) { return(0); }
+  int available() { return(0); }
+  int read() { return(-1); }
+};
+inline TwoWire Wire;
@@ -0,0 +1,6 @@
+/**
+ * @file arraymacros.h
+ * @brief Host stub: NOP100 uses none of the library's macros.
+ */
+
+#pragma once
@@ -0,0 +1,19 @@
+/**
+ * @file i2c_driver.h
+ * @brief Host stub of the teensy4_i2c master driver.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+class I2CMaster {
+  public:
+    virtual ~I2CMaster() {}
+    virtual void begin(uint32_t) {}
+    virtual bool finished() { return(true); }
+    virtual bool has_error() { return(false); }
+    virtual void write_async(uint16_t, uint8_t *, size_t, bool) {}
+    virtual void read_async(uint16_t, uint8_t *, size_t, bool) {}
+};
@@ -0,0 +1,8 @@
+/**
+ * @file i2c_driver_wire.h
+ * @brief Host stub: teensy4_i2c's Wire replacement is the Wire stub.
+ */
+
+#pragma once
+
+#include <Wire.h>
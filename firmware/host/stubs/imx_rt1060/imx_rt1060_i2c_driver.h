@@ -0,0 +1,11 @@
+/**
+ * @file imx_rt1060_i2c_driver.h
+ * @brief Host stub of the teensy4_i2c LPI2C master.
+ */
+
+#pragma once
+
+#include "../i2c_driver.h"
+
+class IMX_RT1060_I2CMaster : public I2CMaster {};
+inline IMX_RT1060_I2CMaster Master;
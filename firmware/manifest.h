@@ -0,0 +1 @@
+modules/NOP100-ROM/manifest.h
\ No newline at end of file
@@ -0,0 +1,88 @@
+/**
+ * @file defines.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Defines for an analogue input module based on a Click 922
+ * module.
+ * @version 0.1
+ * @date 2024-08-26
+ * @copyright Copyright (c) 2024
+ */
+
+/**********************************************************************
+ * @brief NMEA2000 device information overrides.
+ */
+#define DEVICE_CLASS 75                 // Sensor Communication Interface
+#define DEVICE_FUNCTION 150             // Fluid Level
+
+/**********************************************************************
+ * @brief NMEA2000 product information overrides.
+ */
+#define PRODUCT_CODE 005
+#define PRODUCT_FIRMWARE_VERSION "240826"
+#define PRODUCT_LEN 1
+#define PRODUCT_TYPE "NOP100-AIM"
+#define PRODUCT_VERSION "240826 (Aug 2024)"
+
+/**********************************************************************
+ * @brief Number of analogue channels supported by the module.
+ */
+#define ANALOG_CHANNEL_COUNT 4
+
+/**********************************************************************
+ * @brief ModuleConfiguration library stuff.
+ *
+ * Module-wide transmission parameters are followed by a block of
+ * MODULE_CONFIGURATION_CHANNEL_SIZE bytes for each analogue channel.
+ * MODULE_CONFIGURATION_CHANNEL_INDEX(c, o) returns the configuration
+ * index of field o in the block for channel c.
+ *
+ * A channel's low and high calibration points are input levels in
+ * 1/255ths of the converter's full scale which correspond to an empty
+ * tank (or zero volts) and a full tank (or the channel's scale
+ * voltage). The scale field gives a tank's capacity in tens of litres
+ * (zero if unknown) or the voltage at the high calibration point in
+ * units of 0.2 volts.
+ */
+#define MODULE_CONFIGURATION_TRANSMIT_PERIOD_INDEX 1              // Index of transmit period in 100s of milli-seconds
+#define MODULE_CONFIGURATION_TRANSMIT_OFFSET_INDEX 2              // Index of transmit offset in 10s of milli-seconds
+#define MODULE_CONFIGURATION_CHANNEL_BASE_INDEX 3                 // Index of first channel configuration block
+
+#define MODULE_CONFIGURATION_CHANNEL_SIZE 6                       // Size of each channel configuration block in bytes
+#define MODULE_CONFIGURATION_CHANNEL_FUNCTION_OFFSET 0            // Offset of channel function (see ANALOG_FUNCTION_...)
+#define MODULE_CONFIGURATION_CHANNEL_FLUID_TYPE_OFFSET 1          // Offset of channel PGN 127505 fluid type
+#define MODULE_CONFIGURATION_CHANNEL_CUTOFF_OFFSET 2              // Offset of channel filter cutoff in 0.01Hz
+#define MODULE_CONFIGURATION_CHANNEL_LOW_OFFSET 3                 // Offset of channel low calibration point
+#define MODULE_CONFIGURATION_CHANNEL_HIGH_OFFSET 4                // Offset of channel high calibration point
+#define MODULE_CONFIGURATION_CHANNEL_SCALE_OFFSET 5               // Offset of channel capacity or scale voltage
+
+#define MODULE_CONFIGURATION_CHANNEL_INDEX(c, o) (MODULE_CONFIGURATION_CHANNEL_BASE_INDEX + ((c) * MODULE_CONFIGURATION_CHANNEL_SIZE) + (o))
+
+/**********************************************************************
+ * @brief Channel functions.
+ */
+#define ANALOG_FUNCTION_DISABLED 0        // Channel is not reported
+#define ANALOG_FUNCTION_TANK_LEVEL 1      // Channel is reported by PGN 127505
+#define ANALOG_FUNCTION_DC_VOLTAGE 2      // Channel is reported by PGN 127508
+
+/**********************************************************************
+ * @brief Signal processing chain.
+ *
+ * All channels are scanned ANALOG_SAMPLE_RATE times a second and
+ * delivered to loop() in blocks of ANALOG_BLOCK_SIZE scans. Each
+ * channel is low-pass filtered and decimated by an ANALOG_FIR_TAPS tap
+ * FIR filter and then smoothed by a second order IIR filter whose
+ * cutoff is set in the module configuration.
+ */
+#define ANALOG_SAMPLE_RATE 1000UL
+#define ANALOG_BLOCK_SIZE 50
+#define ANALOG_FIR_TAPS 32
+#define ANALOG_DECIMATION_FACTOR 10
+
+/**********************************************************************
+ * @brief MikroBus card bindings.
+ *
+ * The left socket hosts a Click 922 ADC module.
+ */
+void processAnalogBlock(const int16_t *samples, unsigned int scans);
+
+#define MIKROBUS_SOCKET_LEFT_CARD MIKROE922Card<MikroBusSocketLeft, ANALOG_CHANNEL_COUNT, ANALOG_SAMPLE_RATE, ANALOG_BLOCK_SIZE, processAnalogBlock>
@@ -0,0 +1,164 @@
+/**
+ * @file definitions.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Everything required to implement NOP100-AIM.
+ * @version 0.1
+ * @date 2024-08-26
+ * @copyright Copyright (c) 2024
+ */
+
+/**
+ * @brief Per-channel signal processing state.
+ *
+ * smoother's output is the channel value as a Q31 fraction of the
+ * converter's full scale.
+ */
+typedef struct {
+  bool valid;                           // Set once the filters have been primed
+  FirDecimator<ANALOG_FIR_TAPS, ANALOG_DECIMATION_FACTOR> decimator;
+  BiquadLowPass smoother;
+} tAnalogChannel;
+
+tAnalogChannel AnalogChannels[ANALOG_CHANNEL_COUNT];
+
+/**********************************************************************
+ * @brief Design a channel's smoothing filter for the cutoff set in the
+ * module configuration.
+ */
+void designAnalogChannelSmoother(unsigned int channel) {
+  uint8_t cutoff = ModuleConfiguration.getByte(MODULE_CONFIGURATION_CHANNEL_INDEX(channel, MODULE_CONFIGURATION_CHANNEL_CUTOFF_OFFSET));
+  double rate = ((double) ANALOG_SAMPLE_RATE / ANALOG_DECIMATION_FACTOR);
+
+  AnalogChannels[channel].smoother.design((cutoff / 100.0) / rate);
+}
+
+/**********************************************************************
+ * @brief Design every channel's filters.
+ *
+ * The decimating filter passes 80% of the band which survives
+ * decimation.
+ */
+void initialiseAnalogChannels() {
+  for (unsigned int c = 0; c < ANALOG_CHANNEL_COUNT; c++) {
+    AnalogChannels[c].valid = false;
+    AnalogChannels[c].decimator.design(0.4 / ANALOG_DECIMATION_FACTOR);
+    designAnalogChannelSmoother(c);
+  }
+}
+
+/**********************************************************************
+ * @brief Callback invoked by the Click 922 driver with each block of
+ * samples.
+ *
+ * A channel's filters are primed from its first sample so that the
+ * reported value does not have to climb from zero through the long
+ * time constant of the smoothing filter.
+ *
+ * @param samples - scans of ANALOG_CHANNEL_COUNT Q15 samples.
+ * @param scans - the number of scans in samples.
+ */
+void processAnalogBlock(const int16_t *samples, unsigned int scans) {
+  int16_t decimated;
+
+  for (unsigned int c = 0; c < ANALOG_CHANNEL_COUNT; c++) {
+    tAnalogChannel *channel = &AnalogChannels[c];
+
+    if (ModuleConfiguration.getByte(MODULE_CONFIGURATION_CHANNEL_INDEX(c, MODULE_CONFIGURATION_CHANNEL_FUNCTION_OFFSET)) == ANALOG_FUNCTION_DISABLED) continue;
+    if (!channel->valid) {
+      channel->decimator.reset(samples[c]);
+      channel->smoother.reset(samples[c]);
+      channel->valid = true;
+    }
+    for (unsigned int s = 0; s < scans; s++) {
+      if (channel->decimator.push(samples[(s * ANALOG_CHANNEL_COUNT) + c], decimated)) channel->smoother.process(decimated);
+    }
+  }
+}
+
+/**********************************************************************
+ * @brief Get a channel's value scaled between its calibration points.
+ *
+ * @return 0.0 at the low calibration point and 1.0 at the high
+ * calibration point, or N2kDoubleNA if the channel has no data or its
+ * calibration points are out of order.
+ */
+double getAnalogChannelValue(unsigned int channel) {
+  double low = ModuleConfiguration.getByte(MODULE_CONFIGURATION_CHANNEL_INDEX(channel, MODULE_CONFIGURATION_CHANNEL_LOW_OFFSET)) / 255.0;
+  double high = ModuleConfiguration.getByte(MODULE_CONFIGURATION_CHANNEL_INDEX(channel, MODULE_CONFIGURATION_CHANNEL_HIGH_OFFSET)) / 255.0;
+  double value = (AnalogChannels[channel].smoother.getOutput() / 2147483648.0);
+
+  if ((!AnalogChannels[channel].valid) || (high <= low)) return(N2kDoubleNA);
+  return((value - low) / (high - low));
+}
+
+/**********************************************************************
+ * @brief Transmit PGN 127505 or PGN 127508 for each enabled channel
+ * and flash transmit LED.
+ *
+ * The message instance is derived from the module instance address
+ * set on the hardware code switches offset by the channel number.
+ * Channels whose message instance would exceed 254 are skipped.
+ */
+void transmitAnalogChannels() {
+  #ifdef DEBUG_SERIAL
+  Serial.println("transmitAnalogChannels()...");
+  #endif
+  static tN2kMsg N2kMsg;
+
+  unsigned char instance = (unsigned char) CodeSwitchPISO.read();
+  bool transmitted = false;
+
+  if (instance == 255) return;
+
+  for (unsigned int c = 0; (c < ANALOG_CHANNEL_COUNT) && ((instance + c) < 255); c++) {
+    double value = getAnalogChannelValue(c);
+    unsigned char scale = ModuleConfiguration.getByte(MODULE_CONFIGURATION_CHANNEL_INDEX(c, MODULE_CONFIGURATION_CHANNEL_SCALE_OFFSET));
+
+    switch (ModuleConfiguration.getByte(MODULE_CONFIGURATION_CHANNEL_INDEX(c, MODULE_CONFIGURATION_CHANNEL_FUNCTION_OFFSET))) {
+      case ANALOG_FUNCTION_TANK_LEVEL:
+        if (value != N2kDoubleNA) value = ((value < 0.0)?0.0:((value > 1.0)?1.0:value)) * 100.0;
+        SetN2kPGN127505(
+          N2kMsg,
+          (unsigned char) (instance + c),
+          (tN2kFluidType) ModuleConfiguration.getByte(MODULE_CONFIGURATION_CHANNEL_INDEX(c, MODULE_CONFIGURATION_CHANNEL_FLUID_TYPE_OFFSET)),
+          value,
+          (scale)?(scale * 10.0):N2kDoubleNA
+        );
+        break;
+      case ANALOG_FUNCTION_DC_VOLTAGE:
+        SetN2kPGN127508(N2kMsg, (unsigned char) (instance + c), (value != N2kDoubleNA)?(value * scale * 0.2):N2kDoubleNA, N2kDoubleNA, N2kDoubleNA, 0xff);
+        break;
+      default:
+        continue;
+    }
+    transmitMessage(N2kMsg);
+    transmitted = true;
+  }
+  if (transmitted) CanLed.setLedState(0, LedManager::ONCE);
+}
+
+/**********************************************************************
+ * @brief ConfigurationChanges handler which redesigns a channel's
+ * smoothing filter when its cutoff is changed and re-primes the
+ * channel's filters when its function is changed.
+ *
+ * A redesigned filter keeps its state, so the reported value does not
+ * jump. A disabled channel's filters see no samples, so a channel
+ * which is re-enabled must be primed afresh rather than report the
+ * value it held when it was disabled.
+ */
+void onAnalogChannelConfigurationChange(unsigned int index, unsigned char value) {
+  unsigned int offset = (index - MODULE_CONFIGURATION_CHANNEL_BASE_INDEX);
+  unsigned int channel = (offset / MODULE_CONFIGURATION_CHANNEL_SIZE);
+
+  switch (offset % MODULE_CONFIGURATION_CHANNEL_SIZE) {
+    case MODULE_CONFIGURATION_CHANNEL_CUTOFF_OFFSET:
+      designAnalogChannelSmoother(channel);
+      break;
+    case MODULE_CONFIGURATION_CHANNEL_FUNCTION_OFFSET:
+      AnalogChannels[channel].valid = false;
+      break;
+    default:
+      break;
+  }
+}
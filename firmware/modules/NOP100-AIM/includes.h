@@ -0,0 +1,12 @@
+/**
+ * @file includes.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief #include directives for required library headers.
+ * @version 0.1
+ * @date 2024-08-26
+ * 
+ * @copyright Copyright (c) 2024
+ */
+
+#include "FixedPointFilter.h"
+#include "MIKROE922Card.h"
@@ -0,0 +1,51 @@
+/**
+ * @file manifest.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Manifest of the messages, configuration and periodic
+ * transmissions of NOP100-AIM.
+ * @version 0.1
+ * @date 2024-09-16
+ * @copyright Copyright (c) 2024
+ */
+
+void transmitAnalogChannels();
+void onAnalogChannelConfigurationChange(unsigned int index, unsigned char value);
+
+/**
+ * @brief Manifest of one analogue channel's configuration block.
+ */
+#define ANALOG_CHANNEL_MANIFEST \
+  { ANALOG_FUNCTION_TANK_LEVEL, ANALOG_FUNCTION_DISABLED, ANALOG_FUNCTION_DC_VOLTAGE }, /* Function */ \
+  { 0x00, 0, 6 },                       /* Fluid type: N2kft_Fuel */ \
+  { 0x05, 1, 255 },                     /* Cutoff: 0.05Hz */ \
+  { 0x00, 0, 255 },                     /* Low: zero volts at the converter */ \
+  { 0xFF, 0, 255 },                     /* High: full scale at the converter */ \
+  { 0x00, 0, 255 }                      /* Scale: capacity unknown */
+
+namespace ModuleManifest {
+
+  constexpr unsigned long TransmittedPGNs[] = { 127505L, 127508L, 0 };
+
+  constexpr tManifestReceivedPGN ReceivedPGNs[] = { { 0L, 0 } };
+
+  constexpr tManifestConfigurationByte Configuration[] = {
+    MODULE_CONFIGURATION_CAN_SOURCE_MANIFEST,
+    { 0x19, 1, 255 },                   // Transmit period: 25 times 100 milliseconds
+    { 0x00, 0, 255 },                   // Transmit offset: zero times 10 milliseconds
+    ANALOG_CHANNEL_MANIFEST,
+    ANALOG_CHANNEL_MANIFEST,
+    ANALOG_CHANNEL_MANIFEST,
+    ANALOG_CHANNEL_MANIFEST
+  };
+
+  constexpr tManifestScheduler Schedulers[] = {
+    { MODULE_CONFIGURATION_TRANSMIT_PERIOD_INDEX, 100UL, MODULE_CONFIGURATION_TRANSMIT_OFFSET_INDEX, 10UL, transmitAnalogChannels },
+    { 0, 0, 0, 0, 0 }
+  };
+
+  constexpr tManifestSubscriber Subscribers[] = {
+    { MODULE_CONFIGURATION_CHANNEL_INDEX(0, 0), MODULE_CONFIGURATION_CHANNEL_INDEX(ANALOG_CHANNEL_COUNT, 0) - 1, onAnalogChannelConfigurationChange },
+    { 0, 0, 0 }
+  };
+
+}
@@ -0,0 +1,10 @@
+/**
+ * @file setup.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Code to be executed in Arduino setup().
+ * @version 0.1
+ * @date 2024-08-26
+ * @copyright Copyright (c) 2024
+ */
+
+initialiseAnalogChannels();
@@ -0,0 +1,48 @@
+/**
+ * @file defines.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Defines for a mixed switch input and relay output module
+ * based on a Click 5981 and a Click 5675 module.
+ * @version 0.1
+ * @date 2024-08-05
+ * @copyright Copyright (c) 2024
+ */
+
+/**********************************************************************
+ * @brief NMEA2000 device information overrides.
+ */
+#define DEVICE_CLASS 30                 // Electrical Distribution
+#define DEVICE_FUNCTION 140             // Load controller
+
+/**********************************************************************
+ * @brief NMEA2000 product information overrides.
+ */
+#define PRODUCT_CODE 004
+#define PRODUCT_FIRMWARE_VERSION "240805"
+#define PRODUCT_LEN 1
+#define PRODUCT_TYPE "NOP100-MIO"
+#define PRODUCT_VERSION "240805 (Aug 2024)"
+
+/**********************************************************************
+ * @brief ModuleConfiguration library stuff.
+ */
+#define MODULE_CONFIGURATION_PGN127501_TRANSMIT_PERIOD_INDEX 1    // Index of PGN 127501 transmit period in seconds
+#define MODULE_CONFIGURATION_PGN127501_TRANSMIT_OFFSET_INDEX 2    // Index of PGN 127501 transmit offset in 10s of milli-seconds
+
+/**********************************************************************
+ * @brief number of milliseconds between checks on switch input and
+ * relay output channel states.
+ */
+#define SWITCHBANK_UPDATE_INTERVAL 100
+
+/**********************************************************************
+ * @brief MikroBus card bindings.
+ *
+ * The left socket hosts a Click 5981 switch input module and the right
+ * socket a Click 5675 relay output module at I2C address 0x71.
+ */
+void updateInputSwitchbankStatus(uint32_t status);
+void updateRelaySwitchbankStatus(uint16_t status);
+
+#define MIKROBUS_SOCKET_LEFT_CARD MIKROE5981Card<MikroBusSocketLeft, updateInputSwitchbankStatus, SWITCHBANK_UPDATE_INTERVAL>
+#define MIKROBUS_SOCKET_RIGHT_CARD MIKROE5675Card<MikroBusSocketRight, 0x71, updateRelaySwitchbankStatus, SWITCHBANK_UPDATE_INTERVAL>
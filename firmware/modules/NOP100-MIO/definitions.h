@@ -0,0 +1,111 @@
+/**
+ * @file definitions.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Everything required to implement NOP100-MIO.
+ * @version 0.1
+ * @date 2024-08-05
+ * @copyright Copyright (c) 2024
+ */
+
+/**
+ * @brief Buffers holding current input and relay channel states.
+ *
+ * The module presents two switchbanks: the input switchbank takes
+ * the module instance set on the code switches and the relay
+ * switchbank takes the following instance. A code switch setting of
+ * 254 or 255 leaves no valid relay instance, so the module neither
+ * transmits nor accepts commands.
+ */
+tN2kBinaryStatus InputSwitchbankStatus;
+tN2kBinaryStatus RelaySwitchbankStatus;
+
+/**
+ * @brief Transmit PGN 127501 for both switchbanks and flash transmit
+ * LED.
+ */
+void transmitPGN127501() {
+  #ifdef DEBUG_SERIAL
+  Serial.println("transmitPGN127501()...");
+  #endif
+  static tN2kMsg N2kMsg;
+
+  // Recover module instance address from the hardware code switches.
+  unsigned char instance = (unsigned char) CodeSwitchPISO.read();
+
+  if (instance < 254) {
+    SetN2kPGN127501(N2kMsg, instance, InputSwitchbankStatus);
+    transmitMessage(N2kMsg);
+    SetN2kPGN127501(N2kMsg, (instance + 1), RelaySwitchbankStatus);
+    transmitMessage(N2kMsg);
+    CanLed.setLedState(0, LedManager::ONCE);
+  }
+}
+
+/**********************************************************************
+ * @brief Update a switchbank buffer from a channel state bitmap.
+ *
+ * @param switchbank - the switchbank to be updated.
+ * @param status - bitmap of channel states, bit 0 being channel 1.
+ * @param channels - the number of channels represented in status.
+ * @return true if any channel changed state.
+ */
+bool updateSwitchbank(tN2kBinaryStatus &switchbank, uint32_t status, unsigned int channels) {
+  bool updated = false;
+  int state;
+
+  for (unsigned int i = 0; i < channels; i++) {
+    state = (status >> i) & 1;
+    if (state != ((N2kGetStatusOnBinaryStatus(switchbank, (i + 1)) == N2kOnOff_On)?1:0)) {
+      N2kSetStatusBinaryOnStatus(switchbank, (state)?N2kOnOff_On:N2kOnOff_Off, (i + 1));
+      updated = true;
+    }
+  }
+  return(updated);
+}
+
+/**********************************************************************
+ * @brief Callback invoked by the left socket's Click 5981 driver with
+ * current switch input states.
+ */
+void updateInputSwitchbankStatus(uint32_t status) {
+  if (updateSwitchbank(InputSwitchbankStatus, status, MIKROBUS_SOCKET_LEFT_CARD::CHANNEL_COUNT)) transmitPGN127501();
+}
+
+/**********************************************************************
+ * @brief Callback invoked by the right socket's Click 5675 driver with
+ * current relay states.
+ */
+void updateRelaySwitchbankStatus(uint16_t status) {
+  if (updateSwitchbank(RelaySwitchbankStatus, status, MIKROBUS_SOCKET_RIGHT_CARD::CHANNEL_COUNT)) transmitPGN127501();
+}
+
+/**********************************************************************
+ * Process a received PGN 127502 Switch Bank Control message addressed
+ * to the relay switchbank by merging the commanded channel states into
+ * the current relay states and passing the result to the relay card.
+ */
+void handlePGN127502(const tN2kMsg &n2kMsg) {
+  uint8_t instance;
+  uint32_t status = 0;
+  bool changed = false;
+  tN2kBinaryStatus commandedSwitchbankStatus;
+  tN2kOnOff commandedChannelStatus;
+  tN2kOnOff currentChannelStatus;
+
+  if (ParseN2kPGN127502(n2kMsg, instance, commandedSwitchbankStatus)) {
+    unsigned char moduleInstance = (unsigned char) CodeSwitchPISO.read();
+
+    if ((moduleInstance < 254) && (instance == (moduleInstance + 1))) {
+      for (unsigned int c = 0; c < MIKROBUS_SOCKET_RIGHT_CARD::CHANNEL_COUNT; c++) {
+        commandedChannelStatus = N2kGetStatusOnBinaryStatus(commandedSwitchbankStatus, (c + 1));
+        currentChannelStatus = N2kGetStatusOnBinaryStatus(RelaySwitchbankStatus, (c + 1));
+        if ((commandedChannelStatus == N2kOnOff_On) || (commandedChannelStatus == N2kOnOff_Off)) {
+          changed = changed || (commandedChannelStatus != currentChannelStatus);
+          currentChannelStatus = commandedChannelStatus;
+        }
+        if (currentChannelStatus == N2kOnOff_On) status |= (1UL << c);
+      }
+      if (changed) MikroBus.right.command(status);
+    }
+  }
+}
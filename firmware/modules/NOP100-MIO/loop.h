@@ -0,0 +1,8 @@
+/**
+ * @file loop.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Code to be executed in Arduino loop().
+ * @version 0.1
+ * @date 2024-08-05
+ * @copyright Copyright (c) 2024
+ */
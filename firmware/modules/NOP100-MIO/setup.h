@@ -0,0 +1,11 @@
+/**
+ * @file setup.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Code to be executed in Arduino setup().
+ * @version 0.1
+ * @date 2024-08-05
+ * @copyright Copyright (c) 2024
+ */
+
+N2kResetBinaryStatus(InputSwitchbankStatus);
+N2kResetBinaryStatus(RelaySwitchbankStatus);
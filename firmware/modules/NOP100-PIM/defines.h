@@ -0,0 +1,73 @@
+/**
+ * @file defines.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Defines for a pulse input module which measures engine speed
+ * and fuel flow from pulse trains on the MikroBus PWM pins.
+ * @version 0.1
+ * @date 2024-09-02
+ * @copyright Copyright (c) 2024
+ */
+
+/**********************************************************************
+ * @brief NMEA2000 device information overrides.
+ */
+#define DEVICE_CLASS 50                 // Propulsion
+#define DEVICE_FUNCTION 160             // Engine Gateway
+
+/**********************************************************************
+ * @brief NMEA2000 product information overrides.
+ */
+#define PRODUCT_CODE 006
+#define PRODUCT_FIRMWARE_VERSION "240902"
+#define PRODUCT_LEN 1
+#define PRODUCT_TYPE "NOP100-PIM"
+#define PRODUCT_VERSION "240902 (Sep 2024)"
+
+/**********************************************************************
+ * @brief Number of pulse input channels supported by the module.
+ *
+ * Channel 0 is taken from the left MikroBus socket's PWM pin and
+ * channel 1 from the right MikroBus socket's PWM pin.
+ */
+#define PULSE_CHANNEL_COUNT 2
+
+/**********************************************************************
+ * @brief ModuleConfiguration library stuff.
+ *
+ * A block of MODULE_CONFIGURATION_CHANNEL_SIZE bytes is used for each
+ * pulse channel. MODULE_CONFIGURATION_CHANNEL_INDEX(c, o) returns the
+ * configuration index of field o in the block for channel c.
+ *
+ * A channel's K-factor is a sixteen bit value held most significant
+ * byte first. For an engine speed channel it is the number of pulses
+ * per revolution in hundredths (so an alternator W terminal with six
+ * pole pairs and a 2.5:1 pulley ratio needs 1500); for a fuel flow
+ * channel it is the number of pulses per litre.
+ *
+ * A channel is measured over and reported at the end of each gating
+ * window. Input frequencies below one pulse per window read as zero.
+ */
+#define MODULE_CONFIGURATION_CHANNEL_BASE_INDEX 1                 // Index of first channel configuration block
+
+#define MODULE_CONFIGURATION_CHANNEL_SIZE 4                       // Size of each channel configuration block in bytes
+#define MODULE_CONFIGURATION_CHANNEL_FUNCTION_OFFSET 0            // Offset of channel function (see PULSE_FUNCTION_...)
+#define MODULE_CONFIGURATION_CHANNEL_KFACTOR_MSB_OFFSET 1         // Offset of channel K-factor most significant byte
+#define MODULE_CONFIGURATION_CHANNEL_KFACTOR_LSB_OFFSET 2         // Offset of channel K-factor least significant byte
+#define MODULE_CONFIGURATION_CHANNEL_GATE_OFFSET 3                // Offset of channel gating window in 100s of milli-seconds
+
+#define MODULE_CONFIGURATION_CHANNEL_INDEX(c, o) (MODULE_CONFIGURATION_CHANNEL_BASE_INDEX + ((c) * MODULE_CONFIGURATION_CHANNEL_SIZE) + (o))
+
+/**********************************************************************
+ * @brief Channel functions.
+ */
+#define PULSE_FUNCTION_DISABLED 0         // Channel is not reported
+#define PULSE_FUNCTION_ENGINE_SPEED 1     // Channel is reported by PGN 127488
+#define PULSE_FUNCTION_FUEL_FLOW 2        // Channel is reported by PGN 127497
+
+/**********************************************************************
+ * @brief Maximum gating window in 100s of milliseconds.
+ *
+ * The final edges of two consecutive windows can be almost two windows
+ * apart and must lie within PULSE_COUNTER_MAXIMUM_INTERVAL.
+ */
+#define PULSE_GATE_MAXIMUM 35
@@ -0,0 +1,116 @@
+/**
+ * @file definitions.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Everything required to implement NOP100-PIM.
+ * @version 0.1
+ * @date 2024-09-02
+ * @copyright Copyright (c) 2024
+ */
+
+/**
+ * @brief Pulse counters on the MikroBus PWM pins.
+ */
+typedef PulseCounter<GPIO_MIKROBUS_MODULE0_PWM> PulseCounterLeft;
+typedef PulseCounter<GPIO_MIKROBUS_MODULE1_PWM> PulseCounterRight;
+
+static_assert((2 * PULSE_GATE_MAXIMUM * 100UL) <= PULSE_COUNTER_MAXIMUM_INTERVAL, "PULSE_GATE_MAXIMUM allows final edges further apart than the cycle counter can time");
+
+/**
+ * @brief Per-channel measurement state.
+ */
+typedef struct {
+  tPulseSnapshot snapshot;                // Snapshot at the end of the last gating window
+  unsigned long windowStartedAt;          // Time at the start of the current gating window
+  bool primed;                            // Set if snapshot's final edge is recent enough to measure from
+  uint64_t totalPulses;                   // Pulses counted since startup
+} tPulseChannel;
+
+tPulseChannel PulseChannels[PULSE_CHANNEL_COUNT];
+
+tPulseSnapshot readPulseCounter(unsigned int channel) {
+  return((channel == 0)?PulseCounterLeft::read():PulseCounterRight::read());
+}
+
+unsigned int getPulseChannelKFactor(unsigned int channel) {
+  return((ModuleConfiguration.getByte(MODULE_CONFIGURATION_CHANNEL_INDEX(channel, MODULE_CONFIGURATION_CHANNEL_KFACTOR_MSB_OFFSET)) << 8) | ModuleConfiguration.getByte(MODULE_CONFIGURATION_CHANNEL_INDEX(channel, MODULE_CONFIGURATION_CHANNEL_KFACTOR_LSB_OFFSET)));
+}
+
+/**********************************************************************
+ * @brief Transmit a channel's measurement and flash transmit LED.
+ *
+ * The message instance is derived from the module instance address
+ * set on the hardware code switches offset by the channel number. A
+ * channel whose message instance would exceed 254 is not transmitted.
+ *
+ * @param channel - the channel to be reported.
+ * @param frequency - pulse frequency over the last gating window in Hz.
+ */
+void transmitPulseChannel(unsigned int channel, double frequency) {
+  #ifdef DEBUG_SERIAL
+  Serial.print("transmitPulseChannel("); Serial.print(channel); Serial.println(")...");
+  #endif
+  static tN2kMsg N2kMsg;
+
+  unsigned char instance = (unsigned char) CodeSwitchPISO.read();
+  unsigned int kFactor = getPulseChannelKFactor(channel);
+
+  if (((instance + channel) > 254) || (kFactor == 0)) return;
+
+  switch (ModuleConfiguration.getByte(MODULE_CONFIGURATION_CHANNEL_INDEX(channel, MODULE_CONFIGURATION_CHANNEL_FUNCTION_OFFSET))) {
+    case PULSE_FUNCTION_ENGINE_SPEED:
+      SetN2kPGN127488(N2kMsg, (unsigned char) (instance + channel), ((frequency * 60.0 * 100.0) / kFactor), N2kDoubleNA, N2kInt8NA);
+      break;
+    case PULSE_FUNCTION_FUEL_FLOW:
+      SetN2kPGN127497(N2kMsg, (unsigned char) (instance + channel), ((double) PulseChannels[channel].totalPulses / kFactor), ((frequency * 3600.0) / kFactor), N2kDoubleNA, N2kDoubleNA);
+      break;
+    default:
+      return;
+  }
+  transmitMessage(N2kMsg);
+  CanLed.setLedState(0, LedManager::ONCE);
+}
+
+/**********************************************************************
+ * @brief Close any gating windows which have expired, measure their
+ * channels and report the result.
+ *
+ * A window in which pulses arrived is measured by reciprocal counting
+ * from the final edge of the previous window. When the previous window
+ * was empty its final edge may be arbitrarily old, so the window is
+ * instead measured by counting pulses over its length in milliseconds
+ * and the next window returns to full resolution.
+ */
+void processPulseChannelsMaybe() {
+  unsigned long now = millis();
+
+  for (unsigned int c = 0; c < PULSE_CHANNEL_COUNT; c++) {
+    tPulseChannel *channel = &PulseChannels[c];
+    unsigned long gate = (ModuleConfiguration.getByte(MODULE_CONFIGURATION_CHANNEL_INDEX(c, MODULE_CONFIGURATION_CHANNEL_GATE_OFFSET)) * 100UL);
+
+    if ((now - channel->windowStartedAt) >= gate) {
+      tPulseSnapshot snapshot = readPulseCounter(c);
+      uint32_t pulses = (snapshot.count - channel->snapshot.count);
+      double frequency = 0.0;
+
+      if (pulses > 0) {
+        frequency = (channel->primed)?pulseFrequency(channel->snapshot, snapshot):((pulses * 1000.0) / (now - channel->windowStartedAt));
+      }
+      channel->totalPulses += pulses;
+      channel->primed = (pulses > 0);
+      channel->snapshot = snapshot;
+      channel->windowStartedAt = now;
+      transmitPulseChannel(c, frequency);
+    }
+  }
+}
+
+void initialisePulseChannels() {
+  unsigned long now = millis();
+
+  for (unsigned int c = 0; c < PULSE_CHANNEL_COUNT; c++) {
+    PulseChannels[c].snapshot = readPulseCounter(c);
+    PulseChannels[c].windowStartedAt = now;
+    PulseChannels[c].primed = false;
+    PulseChannels[c].totalPulses = 0;
+  }
+}
@@ -0,0 +1,11 @@
+/**
+ * @file includes.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief #include directives for required library headers.
+ * @version 0.1
+ * @date 2024-09-02
+ * 
+ * @copyright Copyright (c) 2024
+ */
+
+#include "PulseCounter.h"
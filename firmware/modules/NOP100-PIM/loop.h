@@ -0,0 +1,10 @@
+/**
+ * @file loop.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Code to be executed in Arduino loop().
+ * @version 0.1
+ * @date 2024-09-02
+ * @copyright Copyright (c) 2024
+ */
+
+processPulseChannelsMaybe();
@@ -0,0 +1,36 @@
+/**
+ * @file manifest.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Manifest of the messages, configuration and periodic
+ * transmissions of NOP100-PIM.
+ * @version 0.1
+ * @date 2024-09-16
+ * @copyright Copyright (c) 2024
+ */
+
+/**
+ * @brief Manifest of one pulse channel's configuration block.
+ */
+#define PULSE_CHANNEL_MANIFEST \
+  { PULSE_FUNCTION_ENGINE_SPEED, PULSE_FUNCTION_DISABLED, PULSE_FUNCTION_FUEL_FLOW }, /* Function */ \
+  { 0x00, 0, 255 },                     /* K-factor MSB: 100 (one pulse per revolution) */ \
+  { 0x64, 0, 255 },                     /* K-factor LSB */ \
+  { 0x05, 1, PULSE_GATE_MAXIMUM }       /* Gate: five times 100 milliseconds */
+
+namespace ModuleManifest {
+
+  constexpr unsigned long TransmittedPGNs[] = { 127488L, 127497L, 0 };
+
+  constexpr tManifestReceivedPGN ReceivedPGNs[] = { { 0L, 0 } };
+
+  constexpr tManifestConfigurationByte Configuration[] = {
+    MODULE_CONFIGURATION_CAN_SOURCE_MANIFEST,
+    PULSE_CHANNEL_MANIFEST,
+    PULSE_CHANNEL_MANIFEST
+  };
+
+  constexpr tManifestScheduler Schedulers[] = { { 0, 0, 0, 0, 0 } };
+
+  constexpr tManifestSubscriber Subscribers[] = { { 0, 0, 0 } };
+
+}
@@ -0,0 +1,13 @@
+/**
+ * @file setup.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Code to be executed in Arduino setup().
+ * @version 0.1
+ * @date 2024-09-02
+ * @copyright Copyright (c) 2024
+ */
+
+PulseCounterLeft::begin(RISING);
+PulseCounterRight::begin(RISING);
+
+initialisePulseChannels();
@@ -7,20 +7,11 @@
  * @copyright Copyright (c) 2024
  */
 
-/**********************************************************************
- * @brief Specify the MikroBus sockets occupied by Click 5675 modules.
- * 
- * Options are MIKROBUS_SOCKET_LEFT, MIKROBUS_SOCKET_RIGHT or
- * MIKROBUS_SOCKET_LEFT_AND_RIGHT.
- */
-#define MIKROBUS_SOCKET_LEFT_AND_RIGHT  // Both sockets
-
 /**********************************************************************
  * @brief NMEA2000 device information overrides.
  */
 #define DEVICE_CLASS 30                 // Electrical Distribution
 #define DEVICE_FUNCTION 140             // Load controller
-#define DEVICE_UNIQUE_NUMBER 108        // Bump me?
 
 /**********************************************************************
  * @brief NMEA2000 product information overrides.
@@ -28,60 +19,121 @@
 #define PRODUCT_CODE 002
 #define PRODUCT_FIRMWARE_VERSION "240716"
 #define PRODUCT_LEN 1
-#define PRODUCT_SERIAL_CODE "002-108"   // PRODUCT_CODE + DEVICE_UNIQUE_NUMBER
-#define PRODUCT_TYPE "NOP100-ROM"           // The product name?
+#define PRODUCT_TYPE "NOP100-ROM"
 #define PRODUCT_VERSION "240716 (Jul 2024)"
 
 /**********************************************************************
- * @brief NMEA2000 transmit and receive PGN overrides.
+ * @brief Number of relay channels supported by the module.
  */
-#define NMEA_TRANSMITTED_PGNS { 127501L, 0 }
-void handlePGN127502(const tN2kMsg &n2kMsg);
-#define NMEA_RECEIVED_PGNS  { { 127502L, handlePGN127502 }, { 0L, 0 } }
+#define RELAY_CHANNEL_COUNT 6
 
 /**********************************************************************
  * @brief ModuleConfiguration library stuff.
+ *
+ * Module-wide transmission parameters are followed by a block of
+ * MODULE_CONFIGURATION_RELAY_CHANNEL_SIZE bytes for each relay channel
+ * and then by the local logic block.
+ * MODULE_CONFIGURATION_RELAY_CHANNEL_INDEX(c, o) returns the
+ * configuration index of field o in the block for channel c.
+ *
+ * A relay channel's mode determines how it responds to a command to
+ * turn on (see RELAY_MODE_...). Its duration is a sixteen bit value
+ * in milliseconds held most significant byte first.
  */
-#define MODULE_CONFIGURATION_SIZE 3                               // Total configuration size in bytes
-
 #define MODULE_CONFIGURATION_PGN127501_TRANSMIT_PERIOD_INDEX 1    // Index of PGN 127501 transmit period in seconds
 #define MODULE_CONFIGURATION_PGN127501_TRANSMIT_OFFSET_INDEX 2    // Index of PGN 127501 transmit offset in 10s of milli-seconds
+#define MODULE_CONFIGURATION_RELAY_CHANNEL_BASE_INDEX 3           // Index of first relay channel configuration block
+#define MODULE_CONFIGURATION_LOCAL_LOGIC_INDEX (MODULE_CONFIGURATION_RELAY_CHANNEL_BASE_INDEX + (RELAY_CHANNEL_COUNT * MODULE_CONFIGURATION_RELAY_CHANNEL_SIZE)) // Index of local logic remote switchbanks and rules
 
-#define MODULE_CONFIGURATION_TRANSMIT_PERIOD_DEFAULT 0x02         // Every two seconds
-#define MODULE_CONFIGURATION_TRANSMIT_OFFSET_DEFAULT 0x00         // Zero times 10 milliseconds
+#define MODULE_CONFIGURATION_RELAY_CHANNEL_SIZE 3                 // Size of each relay channel configuration block in bytes
+#define MODULE_CONFIGURATION_RELAY_CHANNEL_MODE_OFFSET 0          // Offset of relay channel mode
+#define MODULE_CONFIGURATION_RELAY_CHANNEL_DURATION_MSB_OFFSET 1  // Offset of relay channel duration most significant byte
+#define MODULE_CONFIGURATION_RELAY_CHANNEL_DURATION_LSB_OFFSET 2  // Offset of relay channel duration least significant byte
 
-#define MODULE_CONFIGURATION_DEFAULT { \
-  MODULE_CONFIGURATION_CAN_SOURCE_DEFAULT, \
-  MODULE_CONFIGURATION_TRANSMIT_PERIOD_DEFAULT, \
-  MODULE_CONFIGURATION_TRANSMIT_OFFSET_DEFAULT \
-}
+#define MODULE_CONFIGURATION_RELAY_CHANNEL_INDEX(c, o) (MODULE_CONFIGURATION_RELAY_CHANNEL_BASE_INDEX + ((c) * MODULE_CONFIGURATION_RELAY_CHANNEL_SIZE) + (o))
 
 /**********************************************************************
- * @brief NOP100 function overrides.
+ * @brief Relay channel modes.
+ *
+ * RELAY_MODE_PULSE turns a relay on for exactly its duration whenever
+ * it is commanded on and ignores commands to turn it off.
+ * RELAY_MODE_MOMENTARY holds a relay on while it is commanded on, but
+ * turns it off if the command is not repeated within its duration, so
+ * a lost controller cannot leave a horn or motor running.
+ * RELAY_MODE_FLASH switches a relay on and off every duration
+ * milliseconds while it is commanded on.
+ * RELAY_MODE_PERSISTENT follows the commanded state like
+ * RELAY_MODE_NORMAL, but the state is saved and restored when the
+ * module is powered up, so that a circuit such as a bilge pump or a
+ * navigation light is not left off by a power interruption.
  */
-#define CONFIGURATION_VALIDATOR
-#define ON_N2K_OPEN
+#define RELAY_MODE_NORMAL 0
+#define RELAY_MODE_PULSE 1
+#define RELAY_MODE_MOMENTARY 2
+#define RELAY_MODE_FLASH 3
+#define RELAY_MODE_PERSISTENT 4
 
 /**********************************************************************
- * @brief Configuration of attached Click 5675 modules.
+ * @brief Persistent relay state storage.
+ *
+ * The states of RELAY_MODE_PERSISTENT channels are journaled in
+ * RELAY_STATE_JOURNAL_SLOT_COUNT records from
+ * RELAY_STATE_JOURNAL_EEPROM_ADDRESS, clear of the module
+ * configuration. A change is saved RELAY_STATE_SAVE_DELAY milliseconds
+ * after it is first made, so that a burst of commands costs at most
+ * one write.
  */
-#define MIKROE5675_MODULE_0 { 0x70, GPIO_MIKROBUS_RST }
-#define MIKROE5675_MODULE_1 { 0x71, GPIO_MIKROBUS_RST }
+#define RELAY_STATE_JOURNAL_EEPROM_ADDRESS 512
+#define RELAY_STATE_JOURNAL_SLOT_COUNT 64
+#define RELAY_STATE_SAVE_DELAY 5000UL
 
-#ifdef MIKROBUS_SOCKET_LEFT
-#define MIKROBUS_CONFIGURATION { MIKROE5675_MODULE_0, { 0,0 } }
-#endif
+/**********************************************************************
+ * @brief Relay timer tick in microseconds and the shortest duration in
+ * milliseconds with which a timed relay channel operates.
+ *
+ * A configured duration below RELAY_MINIMUM_DURATION (including zero)
+ * is raised to it, so that a flashing channel cannot toggle its relay
+ * and transmit PGN 127501 on every timer tick.
+ */
+#define RELAY_TIMER_TICK 1000UL
+#define RELAY_MINIMUM_DURATION 100UL
 
-#ifdef MIKROBUS_SOCKET_RIGHT
-#define MIKROBUS_CONFIGURATION { MIKROE5675_MODULE_1, { 0,0 } }
-#endif
+/**********************************************************************
+ * @brief Override onPowerUp() so that persistent relay states are
+ * restored before anything else is started, which is still about 300
+ * milliseconds after reset (see onPowerUp()).
+ */
+#define ON_POWER_UP
 
-#ifdef MIKROBUS_SOCKET_LEFT_AND_RIGHT
-#define MIKROBUS_CONFIGURATION { MIKROE5675_MODULE_0, MIKROE5675_MODULE_1, { 0,0 } }
-#endif
+/**********************************************************************
+ * @brief LocalLogic overrides.
+ *
+ * Relay channels are local channels 0 through 5. Rules can also read
+ * the states of up to two remote switchbanks, typically NOP100-SIM
+ * modules, so that a switch input can operate a relay directly.
+ */
+#define LOCAL_LOGIC_RULE_COUNT 8
+#define LOCAL_LOGIC_REMOTE_BANK_COUNT 2
+#define LOCAL_LOGIC_LOCAL_CHANNEL_COUNT RELAY_CHANNEL_COUNT
+#define LOCAL_LOGIC_CONFIGURATION_INDEX MODULE_CONFIGURATION_LOCAL_LOGIC_INDEX
 
 /**********************************************************************
- * @brief number of milliseconds between checks on switch input channel
+ * @brief number of milliseconds between checks on relay channel
  * states.
  */
 #define SWITCHBANK_UPDATE_INTERVAL 100
+
+/**********************************************************************
+ * @brief MikroBus card bindings.
+ *
+ * Each socket hosts a Click 5675 relay card, the left hand card at I2C
+ * address 0x70 and the right hand card at 0x71. Relay channels are
+ * numbered through the left hand card and then the right hand card.
+ * A module with a single card binds MikroBusEmptyCard to the unused
+ * socket.
+ */
+void updateLeftRelayStatus(uint16_t status);
+void updateRightRelayStatus(uint16_t status);
+
+#define MIKROBUS_SOCKET_LEFT_CARD MIKROE5675Card<MikroBusSocketLeft, 0x70, updateLeftRelayStatus, SWITCHBANK_UPDATE_INTERVAL>
+#define MIKROBUS_SOCKET_RIGHT_CARD MIKROE5675Card<MikroBusSocketRight, 0x71, updateRightRelayStatus, SWITCHBANK_UPDATE_INTERVAL>
@@ -8,16 +8,11 @@
  */
 
 /**
- * @brief Scheduler instance to manage transmission of PGN 127501.
+ * @brief Relay channels provided by the left and right hand cards.
  */
-tN2kSyncScheduler PGN127501Scheduler;
-
-/**
- * @brief Interface to Click 5981 MikroBus modules
- */
-
-MIKROE5675::tConfig MikroBusConfiguration[3] = MIKROBUS_CONFIGURATION;
-MIKROE5675S MikrobusRelayOutputs (MikroBusConfiguration);
+const unsigned int RelayChannelCount = (MIKROBUS_SOCKET_LEFT_CARD::CHANNEL_COUNT + MIKROBUS_SOCKET_RIGHT_CARD::CHANNEL_COUNT);
+const uint32_t LeftRelayChannels = ((1UL << MIKROBUS_SOCKET_LEFT_CARD::CHANNEL_COUNT) - 1);
+const uint32_t RightRelayChannels = (((1UL << MIKROBUS_SOCKET_RIGHT_CARD::CHANNEL_COUNT) - 1) << MIKROBUS_SOCKET_LEFT_CARD::CHANNEL_COUNT);
 
 /**
  * @brief Buffer holding current input channel states.
@@ -26,52 +21,177 @@ MIKROE5675S MikrobusRelayOutputs (MikroBusConfiguration);
  * representation because this can then be used without further
  * processing in a PGN 127501 message.
  * 
- * The buffer is updated directly each time the Click 5981 modules
- * are polled for their channel states.
+ * The buffer is updated directly each time the Click 5675 cards
+ * are polled for their relay states.
  */
 tN2kBinaryStatus SwitchbankStatus;
 
+/**
+ * @brief Bitmap of relay states, bit 0 being channel 1.
+ *
+ * The bitmap is refreshed each time the Click 5675 cards are polled
+ * and amended by local logic rules, so that a rule changing one relay
+ * does not disturb the others.
+ */
+uint32_t RelayOutputStatus = 0;
+
 /**********************************************************************
- * Process a received PGN 127502 Switch Bank Control message by
- * decoding the switchbank status message and comparing the requested
- * channel state(s) with the current SwitchbankStatus. Any mismatch 
- * results in a call to update the appropriate MikroE 5675 module to
- * reflect the state commanded by the received PGN.
+ * @brief Write RelayOutputStatus to the relay cards.
  */
-void handlePGN127502(const tN2kMsg &n2kMsg) {
-  uint8_t instance;
-  uint8_t index;
-  uint32_t statusByte;
-  bool changed = false;
-  tN2kBinaryStatus commandedSwitchbankStatus;
-  tN2kOnOff commandedChannelStatus;
+void writeRelayOutputStatus() {
+  MikroBus.left.command(RelayOutputStatus & LeftRelayChannels);
+  MikroBus.right.command((RelayOutputStatus & RightRelayChannels) >> MIKROBUS_SOCKET_LEFT_CARD::CHANNEL_COUNT);
+}
 
-  // retrieve target instance and switchbank status
-  if (ParseN2kPGN127501(n2kMsg, instance, commandedSwitchbankStatus)) {
-    // if we are the target instance
-    if (instance == (unsigned char) CodeSwitchPISO.read()) {
-      // iterate over configured relay modules
-      for (unsigned int m = 0; m < MikrobusRelayOutputs.getModuleCount(); m++) {
-        statusByte = 0;
-        // iterate over relay channels
-        for (unsigned int c = 0; c < MIKROE5675::CHANNEL_COUNT; c++) {
-          // compute index into switchbank status structure
-          index = (m * MIKROE5675::CHANNEL_COUNT) + c + 1;
-          // recover commanded state of channel at index
-          commandedChannelStatus = N2kGetStatusOnBinaryStatus(commandedSwitchbankStatus, index);
-          // Make sure commanded state is valid
-          if ((commandedChannelStatus == N2kOnOff_On) || (commandedChannelStatus == N2kOnOff_Off)) { 
-            // Make a status byte equivalent to the commanded status for this relay module
-            statusByte = (statusByte << 1) | ((commandedChannelStatus == N2kOnOff_On)?1:0);
-            // Flag if the commanded state is different to the current state       
-            changed = changed || (commandedChannelStatus != N2kGetStatusOnBinaryStatus(SwitchbankStatus, index));
-          }
-        }
-      }
-      // If flagged then update the current module to the commanded state
-      if (changed) MikrobusRelayOutputs.setStatus(statusByte);
-    }
+/**
+ * @brief Relay timer state.
+ *
+ * relayTimerHandler() runs every RELAY_TIMER_TICK microseconds from a
+ * hardware interval timer and flags in RelayTimerExpired each armed
+ * channel whose deadline has passed. It never touches the relays: the
+ * I2C write that acts on an expiry is made from loop() by
+ * processRelayTimersMaybe().
+ *
+ * Only loop() writes RelayTimerArmed and RelayTimerDeadlines, and it
+ * does so with interrupts disabled, together with clearing the
+ * channel's RelayTimerExpired bit, so the handler never sees a channel
+ * armed with a stale deadline. Only the handler sets bits in
+ * RelayTimerExpired.
+ */
+static_assert(RELAY_CHANNEL_COUNT == (MIKROBUS_SOCKET_LEFT_CARD::CHANNEL_COUNT + MIKROBUS_SOCKET_RIGHT_CARD::CHANNEL_COUNT), "RELAY_CHANNEL_COUNT must equal the number of channels on the bound relay cards");
+static_assert(RELAY_CHANNEL_COUNT <= 32, "relay timer bitmaps hold at most 32 channels");
+
+IntervalTimer RelayTimer;
+volatile uint32_t RelayTimerTicks = 0;
+volatile uint32_t RelayTimerDeadlines[RELAY_CHANNEL_COUNT];
+volatile uint32_t RelayTimerArmed = 0;
+volatile uint32_t RelayTimerExpired = 0;
+
+/**
+ * @brief Persistent relay state.
+ *
+ * RelayStateJournal holds the last saved states of RELAY_MODE_PERSISTENT
+ * channels. A change to those states starts the save timer and the
+ * states as they are when it expires are saved, if they still differ
+ * from the journal.
+ *
+ * RelayStateRestoredAt is the time in microseconds from reset (strictly
+ * from the start of the system tick, which precedes the Teensy core's
+ * USB startup delays) at which the relays were restored and RelayStateRestoreDuration the time the
+ * restore took.
+ */
+static_assert(RELAY_CHANNEL_COUNT <= 8, "relay state journal holds at most eight channels");
+static_assert((MODULE_CONFIGURATION_EEPROM_STORAGE_ADDRESS + MODULE_CONFIGURATION_SIZE) <= RELAY_STATE_JOURNAL_EEPROM_ADDRESS, "relay state journal overlaps module configuration");
+
+EepromJournal<RELAY_STATE_JOURNAL_EEPROM_ADDRESS, RELAY_STATE_JOURNAL_SLOT_COUNT> RelayStateJournal;
+bool RelayStateSavePending = false;
+unsigned long RelayStateSaveDeadline = 0;
+unsigned long RelayStateRestoredAt = 0;
+unsigned long RelayStateRestoreDuration = 0;
+
+/**********************************************************************
+ * @brief Get a bitmap of the relay channels whose state is persistent.
+ */
+uint32_t getPersistentRelayChannels() {
+  uint32_t retval = 0;
+
+  for (unsigned int c = 0; c < RELAY_CHANNEL_COUNT; c++) {
+    if (ModuleConfiguration.getByte(MODULE_CONFIGURATION_RELAY_CHANNEL_INDEX(c, MODULE_CONFIGURATION_RELAY_CHANNEL_MODE_OFFSET)) == RELAY_MODE_PERSISTENT) retval |= (1UL << c);
   }
+  return(retval);
+}
+
+/**********************************************************************
+ * @brief Start the save timer if persistent relay states differ from
+ * those last saved.
+ *
+ * A timer which is already running is not restarted, so a channel
+ * which is switched continually is still saved every
+ * RELAY_STATE_SAVE_DELAY milliseconds.
+ */
+void scheduleRelayStateSave() {
+  if (RelayStateSavePending) return;
+  if ((RelayOutputStatus & getPersistentRelayChannels()) != RelayStateJournal.read()) {
+    RelayStateSaveDeadline = (millis() + RELAY_STATE_SAVE_DELAY);
+    RelayStateSavePending = true;
+  }
+}
+
+/**********************************************************************
+ * @brief Save persistent relay states if the save timer has expired.
+ */
+void saveRelayStateMaybe() {
+  uint8_t state;
+
+  if ((!RelayStateSavePending) || ((long) (millis() - RelayStateSaveDeadline) < 0)) return;
+  RelayStateSavePending = false;
+  state = (uint8_t) (RelayOutputStatus & getPersistentRelayChannels());
+  if (state != RelayStateJournal.read()) {
+    #ifdef DEBUG_SERIAL
+    Serial.print("saveRelayStateMaybe(): saving "); Serial.println(state, BIN);
+    #endif
+    RelayStateJournal.write(state);
+  }
+}
+
+/**********************************************************************
+ * @brief Recover the saved states of persistent relay channels into
+ * RelayOutputStatus.
+ *
+ * Only the journal is read: the journal never holds the state of a
+ * channel which was not persistent when it was saved, and a change of
+ * channel mode is saved at once (see onRelayChannelConfigurationChange()),
+ * so the restore does not depend on the module configuration having
+ * been loaded.
+ */
+void restoreRelayState() {
+  if (RelayStateJournal.begin()) RelayOutputStatus = (RelayStateJournal.read() & ((1UL << RELAY_CHANNEL_COUNT) - 1));
+}
+
+/**********************************************************************
+ * @brief ConfigurationChanges handler which saves persistent relay
+ * states at once when a relay channel's mode is changed.
+ *
+ * A channel which stops being persistent is thereby removed from the
+ * journal before a power interruption could restore it.
+ */
+void onRelayChannelConfigurationChange(unsigned int index, unsigned char value) {
+  if (((index - MODULE_CONFIGURATION_RELAY_CHANNEL_BASE_INDEX) % MODULE_CONFIGURATION_RELAY_CHANNEL_SIZE) == MODULE_CONFIGURATION_RELAY_CHANNEL_MODE_OFFSET) {
+    RelayStateSaveDeadline = millis();
+    RelayStateSavePending = true;
+  }
+}
+
+void relayTimerHandler() {
+  uint32_t now = ++RelayTimerTicks;
+
+  for (uint32_t armed = RelayTimerArmed; armed; armed &= (armed - 1)) {
+    unsigned int c = __builtin_ctz(armed);
+    if ((int32_t) (now - RelayTimerDeadlines[c]) >= 0) RelayTimerExpired |= (1UL << c);
+  }
+}
+
+/**********************************************************************
+ * @brief Arm a channel's timer for its configured duration.
+ *
+ * Durations shorter than RELAY_MINIMUM_DURATION are raised to it.
+ */
+void armRelayTimer(unsigned int channel) {
+  uint32_t duration = ((ModuleConfiguration.getByte(MODULE_CONFIGURATION_RELAY_CHANNEL_INDEX(channel, MODULE_CONFIGURATION_RELAY_CHANNEL_DURATION_MSB_OFFSET)) << 8) | ModuleConfiguration.getByte(MODULE_CONFIGURATION_RELAY_CHANNEL_INDEX(channel, MODULE_CONFIGURATION_RELAY_CHANNEL_DURATION_LSB_OFFSET)));
+
+  if (duration < RELAY_MINIMUM_DURATION) duration = RELAY_MINIMUM_DURATION;
+  noInterrupts();
+  RelayTimerDeadlines[channel] = (RelayTimerTicks + ((duration * 1000UL) / RELAY_TIMER_TICK));
+  RelayTimerArmed |= (1UL << channel);
+  RelayTimerExpired &= ~(1UL << channel);
+  interrupts();
+}
+
+void disarmRelayTimer(unsigned int channel) {
+  noInterrupts();
+  RelayTimerArmed &= ~(1UL << channel);
+  RelayTimerExpired &= ~(1UL << channel);
+  interrupts();
 }
 
 /**
@@ -92,25 +212,22 @@ void transmitPGN127501() {
 
   if (instance != 255) {
     SetN2kPGN127501(N2kMsg, instance, SwitchbankStatus);
-    NMEA2000.SendMsg(N2kMsg);
+    transmitMessage(N2kMsg);
     CanLed.setLedState(0, LedManager::ONCE);
   }
 }  
 
 /**********************************************************************
- * @brief Record switch channel input states and respond to any state
+ * @brief Record relay channel states and respond to any state
  * changes.
  * 
  * If a channel has changed state then the value of SwitchbankStatus
  * is updated and a call is made to immediately transmit the update
  * over NMEA.
  * 
- * This function is intended to operate as a callback method for
- * IC74HC165.
- * 
- * @param status - current status of modules switch input channels.
+ * @param status - current status of the module's relay channels.
  */
-void updateSwitchbankStatus(uint16_t status) {
+void updateSwitchbankStatus(uint32_t status) {
   bool updated = false;
   int state;
 
@@ -118,61 +235,176 @@ void updateSwitchbankStatus(uint16_t status) {
   Serial.print("processSwitchInputs("); Serial.println(")...");
   #endif
 
-  for (unsigned int i = 0; i < (MIKROE5675::CHANNEL_COUNT * MikrobusRelayOutputs.getModuleCount()); i++) {
-    state = (status >> i) && 1;
+  RelayOutputStatus = status;
+  for (unsigned int i = 0; i < RelayChannelCount; i++) {
+    state = (status >> i) & 1;
     if (state != ((N2kGetStatusOnBinaryStatus(SwitchbankStatus, (i + 1)) == N2kOnOff_On)?1:0)) {
       N2kSetStatusBinaryOnStatus(SwitchbankStatus, (state)?N2kOnOff_On:N2kOnOff_Off, (i + 1));
+      LocalLogic.setLocal(i, state);
       updated = true;
     }
   }
   if (updated) transmitPGN127501();
 }
 
-///////////////////////////////////////////////////////////////////////
-// The following functions override the defaults provided in NOP100. //
-///////////////////////////////////////////////////////////////////////
-
-/**
- * @brief Callback invoked when N2K bus connection becomes active.
- * 
- * Start the scheduler used for transmission of PGN 127501 supplying
- * configuration data from the module configuration.
- * 
- * @note Overrides the eponymous function in NOP100.
+/**********************************************************************
+ * @brief Callbacks invoked by the left and right hand card drivers
+ * with the states of their own relays.
  */
-void onN2kOpen() {
-  #ifdef DEBUG_SERIAL
-  Serial.println("OnN2kOpen()...");
-  #endif
+void updateLeftRelayStatus(uint16_t status) {
+  updateSwitchbankStatus((RelayOutputStatus & ~LeftRelayChannels) | (status & LeftRelayChannels));
+}
 
-  PGN127501Scheduler.SetPeriodAndOffset(
-    (uint32_t) (ModuleConfiguration.getByte(MODULE_CONFIGURATION_PGN127501_TRANSMIT_PERIOD_INDEX) * 1000),
-    (uint32_t) (ModuleConfiguration.getByte(MODULE_CONFIGURATION_PGN127501_TRANSMIT_OFFSET_INDEX) * 10)
-  );
+void updateRightRelayStatus(uint16_t status) {
+  updateSwitchbankStatus((RelayOutputStatus & ~RightRelayChannels) | (((uint32_t) status << MIKROBUS_SOCKET_LEFT_CARD::CHANNEL_COUNT) & RightRelayChannels));
 }
 
-/**
- * @brief ModuleConfiguration callback invoked to validate proposed
- * changes to the module configuration.
- * 
- * @note Overrides the eponymous function in NOP100.
+/**********************************************************************
+ * @brief Write RelayOutputStatus to the relay cards, report any
+ * change immediately and schedule the saving of persistent states.
  */
-bool configurationValidator(unsigned int index, unsigned char value) {
-  #ifdef DEBUG_SERIAL
-  Serial.print("configurationValidator("); Serial.print(index); Serial.print(", "); Serial.print(value); Serial.println(")...");
-  #endif
-  
-  switch (index) {
-    case MODULE_CONFIGURATION_CAN_SOURCE_INDEX:
-      return(true);
-    case MODULE_CONFIGURATION_PGN127501_TRANSMIT_PERIOD_INDEX:
-      return(true);
+void applyRelayOutputStatus() {
+  writeRelayOutputStatus();
+  updateSwitchbankStatus(RelayOutputStatus);
+  scheduleRelayStateSave();
+}
+
+/**********************************************************************
+ * @brief Apply a command to a relay channel according to the
+ * channel's mode.
+ *
+ * Only RelayOutputStatus is changed: the caller must pass the result
+ * to the relay modules with applyRelayOutputStatus().
+ *
+ * @param channel - the relay channel (0 through 5).
+ * @param state - the commanded state.
+ */
+void commandRelayChannel(unsigned int channel, bool state) {
+  uint32_t bit = (1UL << channel);
+  uint8_t mode = ModuleConfiguration.getByte(MODULE_CONFIGURATION_RELAY_CHANNEL_INDEX(channel, MODULE_CONFIGURATION_RELAY_CHANNEL_MODE_OFFSET));
+
+  switch (mode) {
+    case RELAY_MODE_PULSE:
+      if ((state) && (!(RelayTimerArmed & bit))) {
+        RelayOutputStatus |= bit;
+        armRelayTimer(channel);
+      }
       break;
-    case MODULE_CONFIGURATION_PGN127501_TRANSMIT_OFFSET_INDEX:
-      return(true);
+    case RELAY_MODE_MOMENTARY:
+    case RELAY_MODE_FLASH:
+      if (state) {
+        if ((mode == RELAY_MODE_MOMENTARY) || (!(RelayTimerArmed & bit))) {
+          RelayOutputStatus |= bit;
+          armRelayTimer(channel);
+        }
+      } else {
+        RelayOutputStatus &= ~bit;
+        disarmRelayTimer(channel);
+      }
       break;
     default:
-      return(false);
+      RelayOutputStatus = (state)?(RelayOutputStatus | bit):(RelayOutputStatus & ~bit);
       break;
   }
 }
+
+/**********************************************************************
+ * Process a received PGN 127502 Switch Bank Control message addressed
+ * to this module by passing each channel which is commanded on or off
+ * to commandRelayChannel() and applying the result.
+ */
+void handlePGN127502(const tN2kMsg &n2kMsg) {
+  uint8_t instance;
+  tN2kBinaryStatus commandedSwitchbankStatus;
+  tN2kOnOff commandedChannelStatus;
+
+  if (ParseN2kPGN127502(n2kMsg, instance, commandedSwitchbankStatus)) {
+    if (instance == (unsigned char) CodeSwitchPISO.read()) {
+      for (unsigned int c = 0; c < RelayChannelCount; c++) {
+        commandedChannelStatus = N2kGetStatusOnBinaryStatus(commandedSwitchbankStatus, (c + 1));
+        if ((commandedChannelStatus == N2kOnOff_On) || (commandedChannelStatus == N2kOnOff_Off)) {
+          commandRelayChannel(c, (commandedChannelStatus == N2kOnOff_On));
+        }
+      }
+      applyRelayOutputStatus();
+    }
+  }
+}
+
+/**********************************************************************
+ * @brief Act on expired relay timers.
+ *
+ * Pulse and momentary channels are turned off and flashing channels
+ * are toggled and re-armed. The change is written to the relays and
+ * reported at once rather than waiting for the next poll of the relay
+ * modules.
+ */
+void processRelayTimersMaybe() {
+  uint32_t expired;
+
+  noInterrupts();
+  expired = RelayTimerExpired;
+  RelayTimerExpired = 0;
+  interrupts();
+
+  if (expired == 0) return;
+  for (uint32_t pending = (expired & RelayTimerArmed); pending; pending &= (pending - 1)) {
+    unsigned int c = __builtin_ctz(pending);
+    if (ModuleConfiguration.getByte(MODULE_CONFIGURATION_RELAY_CHANNEL_INDEX(c, MODULE_CONFIGURATION_RELAY_CHANNEL_MODE_OFFSET)) == RELAY_MODE_FLASH) {
+      RelayOutputStatus ^= (1UL << c);
+      armRelayTimer(c);
+    } else {
+      RelayOutputStatus &= ~(1UL << c);
+      disarmRelayTimer(c);
+    }
+  }
+  applyRelayOutputStatus();
+}
+
+/**********************************************************************
+ * @brief Callback invoked by the local logic engine when a rule output
+ * changes state.
+ *
+ * @param channel - the relay channel (0 through 5).
+ * @param state - the new relay state.
+ */
+void localLogicOutputHandler(unsigned int channel, bool state) {
+  #ifdef DEBUG_SERIAL
+  Serial.print("localLogicOutputHandler("); Serial.print(channel); Serial.print(", "); Serial.print(state); Serial.println(")...");
+  #endif
+
+  commandRelayChannel(channel, state);
+  applyRelayOutputStatus();
+}
+
+/**********************************************************************
+ * @brief Restore persistent relay states as soon as the module is
+ * powered up.
+ *
+ * This runs before NOP100 starts its own peripherals and the steps
+ * are made explicitly, in order:
+ *
+ * 1. The saved states are read from the relay state journal alone.
+ * 2. They are passed to the relay card drivers, which only record
+ *    them because the cards have not yet been begun.
+ * 3. Each card is begun, which loads the recorded states into its
+ *    expander and then configures the relay pins as outputs.
+ *
+ * NOP100's own MikroBus.begin() later repeats step 3 harmlessly.
+ *
+ * The Teensy core reaches setup() only after its USB startup delays,
+ * about 300 milliseconds after reset. The restore is not moved into
+ * startup_middle_hook(), which runs before them, because it needs the
+ * journal, the I2C driver and the card drivers and no constructor has
+ * run at that point.
+ */
+void onPowerUp() {
+  unsigned long start = micros();
+
+  restoreRelayState();
+  writeRelayOutputStatus();
+  MikroBus.left.begin();
+  MikroBus.right.begin();
+  RelayStateRestoredAt = micros();
+  RelayStateRestoreDuration = (RelayStateRestoredAt - start);
+}
@@ -8,5 +8,6 @@
  * @copyright Copyright (c) 2023
  */
 
-#include <MIKROE5675S.h>
+#include "MIKROE5675Card.h"
+#include "EepromJournal.h"
 
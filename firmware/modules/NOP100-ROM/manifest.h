@@ -0,0 +1,51 @@
+/**
+ * @file manifest.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Manifest of the messages, configuration and periodic
+ * transmissions of NOP100-ROM.
+ * @version 0.1
+ * @date 2024-09-16
+ * @copyright Copyright (c) 2024
+ */
+
+void transmitPGN127501();
+void handlePGN127502(const tN2kMsg &N2kMsg);
+void onRelayChannelConfigurationChange(unsigned int index, unsigned char value);
+
+/**
+ * @brief Manifest of one relay channel's configuration block.
+ */
+#define RELAY_CHANNEL_MANIFEST \
+  { RELAY_MODE_NORMAL, RELAY_MODE_NORMAL, RELAY_MODE_PERSISTENT }, /* Mode */ \
+  { 0x01, 0, 255 },                     /* Duration MSB: 500 milliseconds */ \
+  { 0xF4, 0, 255 }                      /* Duration LSB */
+
+namespace ModuleManifest {
+
+  constexpr unsigned long TransmittedPGNs[] = { 127501L, 0 };
+
+  constexpr tManifestReceivedPGN ReceivedPGNs[] = { { 127501L, handleLocalLogicPGN127501 }, { 127502L, handlePGN127502 }, { 0L, 0 } };
+
+  constexpr tManifestConfigurationByte Configuration[] = {
+    MODULE_CONFIGURATION_CAN_SOURCE_MANIFEST,
+    { 0x02, 0, 255 },                   // PGN 127501 transmit period: every two seconds
+    { 0x00, 0, 255 },                   // PGN 127501 transmit offset: zero times 10 milliseconds
+    RELAY_CHANNEL_MANIFEST,
+    RELAY_CHANNEL_MANIFEST,
+    RELAY_CHANNEL_MANIFEST,
+    RELAY_CHANNEL_MANIFEST,
+    RELAY_CHANNEL_MANIFEST,
+    RELAY_CHANNEL_MANIFEST
+  };
+
+  constexpr tManifestScheduler Schedulers[] = {
+    { MODULE_CONFIGURATION_PGN127501_TRANSMIT_PERIOD_INDEX, 1000UL, MODULE_CONFIGURATION_PGN127501_TRANSMIT_OFFSET_INDEX, 10UL, transmitPGN127501 },
+    { 0, 0, 0, 0, 0 }
+  };
+
+  constexpr tManifestSubscriber Subscribers[] = {
+    { MODULE_CONFIGURATION_RELAY_CHANNEL_BASE_INDEX, (MODULE_CONFIGURATION_LOCAL_LOGIC_INDEX - 1), onRelayChannelConfigurationChange },
+    { 0, 0, 0 }
+  };
+
+}
@@ -7,7 +7,10 @@
  * @copyright Copyright (c) 2023
  */
 
-Wire.begin();
+#ifdef DEBUG_SERIAL
+Serial.print("Relay states restored "); Serial.print(RelayStateRestoredAt); Serial.print("us after reset in "); Serial.print(RelayStateRestoreDuration); Serial.println("us");
+#endif
 
-MikrobusRelayOutputs.configureCallback(updateSwitchbankStatus, SWITCHBANK_UPDATE_INTERVAL);
-N2kResetBinaryStatus(SwitchbankStatus);
\ No newline at end of file
+N2kResetBinaryStatus(SwitchbankStatus);
+
+RelayTimer.begin(relayTimerHandler, RELAY_TIMER_TICK);
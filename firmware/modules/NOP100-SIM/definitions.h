@@ -8,15 +8,16 @@
  */
 
 /**
- * @brief Scheduler instance to manage transmission of PGN 127501.
+ * @brief Switch channels provided by the left and right hand cards.
  */
-tN2kSyncScheduler PGN127501Scheduler;
+const unsigned int SwitchChannelCount = (MIKROBUS_SOCKET_LEFT_CARD::CHANNEL_COUNT + MIKROBUS_SOCKET_RIGHT_CARD::CHANNEL_COUNT);
+const uint32_t LeftSwitchChannels = ((1UL << MIKROBUS_SOCKET_LEFT_CARD::CHANNEL_COUNT) - 1);
+const uint32_t RightSwitchChannels = (((1UL << MIKROBUS_SOCKET_RIGHT_CARD::CHANNEL_COUNT) - 1) << MIKROBUS_SOCKET_LEFT_CARD::CHANNEL_COUNT);
 
 /**
- * @brief Interface to Click 5981 MikroBus modules
+ * @brief Bitmap of switch input states, bit 0 being channel 1.
  */
-MIKROE5981::tPins MikroBusConfiguration[3] = MIKROBUS_CONFIGURATION;
-MIKROE5981S MikrobusSwitchInputs (MikroBusConfiguration);
+uint32_t SwitchInputStatus = 0;
 
 /**
  * @brief Buffer holding current input channel states.
@@ -48,7 +49,7 @@ void transmitPGN127501() {
 
   if (instance != 255) {
     SetN2kPGN127501(N2kMsg, instance, SwitchbankStatus);
-    NMEA2000.SendMsg(N2kMsg);
+    transmitMessage(N2kMsg);
     CanLed.setLedState(0, LedManager::ONCE);
   }
 }  
@@ -61,10 +62,8 @@ void transmitPGN127501() {
  * is updated and a call is made to immediately transmit the update
  * over NMEA.
  * 
- * This function is intended to operate as a callback method for
- * MIKROE5981.
- * 
- * @param status - current status of modules switch input channels.
+ * @param status - current status of the module's switch input
+ * channels.
  */
 void updateSwitchbankStatus(uint32_t status) {
   bool updated = false;
@@ -74,8 +73,9 @@ void updateSwitchbankStatus(uint32_t status) {
   Serial.print("updateSwitchbankStatus("); Serial.println(")...");
   #endif
 
-  for (unsigned int i = 0; i < (MIKROE5981::CHANNEL_COUNT * MikrobusSwitchInputs.getModuleCount()); i++) {
-    state = (status >> i) && 1;
+  SwitchInputStatus = status;
+  for (unsigned int i = 0; i < SwitchChannelCount; i++) {
+    state = (status >> i) & 1;
     if (state != ((N2kGetStatusOnBinaryStatus(SwitchbankStatus, (i + 1)) == N2kOnOff_On)?1:0)) {
       N2kSetStatusBinaryOnStatus(SwitchbankStatus, (state)?N2kOnOff_On:N2kOnOff_Off, (i + 1));
       updated = true;
@@ -84,52 +84,14 @@ void updateSwitchbankStatus(uint32_t status) {
   if (updated) transmitPGN127501();
 }
 
-///////////////////////////////////////////////////////////////////////
-// The following functions override the defaults provided in NOP100. //
-///////////////////////////////////////////////////////////////////////
-
-/**
- * @brief Callback invoked when N2K bus connection becomes active.
- * 
- * Start the scheduler used for transmission of PGN 127501 supplying
- * configuration data from the module configuration.
- * 
- * @note Overrides the eponymous function in NOP100.
+/**********************************************************************
+ * @brief Callbacks invoked by the left and right hand card drivers
+ * with the states of their own switch input channels.
  */
-void onN2kOpen() {
-  #ifdef DEBUG_SERIAL
-  Serial.println("OnN2kOpen()...");
-  #endif
-
-  // Initialise and start scheduler...
-  PGN127501Scheduler.SetPeriodAndOffset(
-    (uint32_t) (ModuleConfiguration.getByte(MODULE_CONFIGURATION_PGN127501_TRANSMIT_PERIOD_INDEX) * 1000),
-    (uint32_t) (ModuleConfiguration.getByte(MODULE_CONFIGURATION_PGN127501_TRANSMIT_OFFSET_INDEX) * 10)
-  );
+void updateLeftSwitchbankStatus(uint32_t status) {
+  updateSwitchbankStatus((SwitchInputStatus & ~LeftSwitchChannels) | (status & LeftSwitchChannels));
 }
 
-/**
- * @brief ModuleConfiguration callback invoked to validate proposed
- * changes to the module configuration.
- * 
- * @note Overrides the eponymous function in NOP100.
- */
-bool configurationValidator(unsigned int index, unsigned char value) {
-  #ifdef DEBUG_SERIAL
-  Serial.print("configurationValidator("); Serial.print(index); Serial.print(", "); Serial.print(value); Serial.println(")...");
-  #endif
-  
-  switch (index) {
-    case MODULE_CONFIGURATION_CAN_SOURCE_INDEX:
-      return(true);
-    case MODULE_CONFIGURATION_PGN127501_TRANSMIT_PERIOD_INDEX:
-      return(true);
-      break;
-    case MODULE_CONFIGURATION_PGN127501_TRANSMIT_OFFSET_INDEX:
-      return(true);
-      break;
-    default:
-      return(false);
-      break;
-  }
+void updateRightSwitchbankStatus(uint32_t status) {
+  updateSwitchbankStatus((SwitchInputStatus & ~RightSwitchChannels) | ((status << MIKROBUS_SOCKET_LEFT_CARD::CHANNEL_COUNT) & RightSwitchChannels));
 }
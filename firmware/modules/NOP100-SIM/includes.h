@@ -8,5 +8,5 @@
  * @copyright Copyright (c) 2024
  */
 
-#include <MIKROE5981S.h>
+#include "MIKROE5981Card.h"
 
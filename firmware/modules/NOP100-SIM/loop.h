@@ -6,7 +6,3 @@
  * @date 2024-07-01
  * @copyright Copyright (c) 2024
  */
-
-MikrobusSwitchInputs.callbackMaybe();
-
-if (PGN127501Scheduler.IsTime()) { PGN127501Scheduler.UpdateNextTime(); transmitPGN127501(); }
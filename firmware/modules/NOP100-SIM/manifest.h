@@ -0,0 +1,32 @@
+/**
+ * @file manifest.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Manifest of the messages, configuration and periodic
+ * transmissions of NOP100-SIM.
+ * @version 0.1
+ * @date 2024-09-16
+ * @copyright Copyright (c) 2024
+ */
+
+void transmitPGN127501();
+
+namespace ModuleManifest {
+
+  constexpr unsigned long TransmittedPGNs[] = { 127501L, 0 };
+
+  constexpr tManifestReceivedPGN ReceivedPGNs[] = { { 0L, 0 } };
+
+  constexpr tManifestConfigurationByte Configuration[] = {
+    MODULE_CONFIGURATION_CAN_SOURCE_MANIFEST,
+    { 0x02, 0, 255 },                   // PGN 127501 transmit period: every two seconds
+    { 0x00, 0, 255 }                    // PGN 127501 transmit offset: zero times 10 milliseconds
+  };
+
+  constexpr tManifestScheduler Schedulers[] = {
+    { MODULE_CONFIGURATION_PGN127501_TRANSMIT_PERIOD_INDEX, 1000UL, MODULE_CONFIGURATION_PGN127501_TRANSMIT_OFFSET_INDEX, 10UL, transmitPGN127501 },
+    { 0, 0, 0, 0, 0 }
+  };
+
+  constexpr tManifestSubscriber Subscribers[] = { { 0, 0, 0 } };
+
+}
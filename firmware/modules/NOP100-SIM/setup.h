@@ -7,8 +7,4 @@
  * @copyright Copyright (c) 2024
  */
 
-SPI.begin();
-
-MikrobusSwitchInputs.configureCallback(updateSwitchbankStatus, SWITCHBANK_UPDATE_INTERVAL);
-
-N2kResetBinaryStatus(SwitchbankStatus);
\ No newline at end of file
+N2kResetBinaryStatus(SwitchbankStatus);
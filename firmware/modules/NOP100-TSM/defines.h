@@ -0,0 +1,97 @@
+/**
+ * @file defines.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Defines for a temperature sensor module based on a Click 1892
+ * module and DS18B20 sensors.
+ * @version 0.1
+ * @date 2024-08-01
+ * @copyright Copyright (c) 2024
+ */
+
+/**********************************************************************
+ * @brief NMEA2000 device information overrides.
+ */
+#define DEVICE_CLASS 75                 // Sensor Communication Interface
+#define DEVICE_FUNCTION 130             // Temperature
+
+/**********************************************************************
+ * @brief NMEA2000 product information overrides.
+ */
+#define PRODUCT_CODE 003
+#define PRODUCT_FIRMWARE_VERSION "240801"
+#define PRODUCT_LEN 1
+#define PRODUCT_TYPE "NOP100-TSM"
+#define PRODUCT_VERSION "240801 (Aug 2024)"
+
+/**********************************************************************
+ * @brief Number of temperature channels supported by the module.
+ */
+#define TEMPERATURE_CHANNEL_COUNT 8
+
+/**********************************************************************
+ * @brief ModuleConfiguration library stuff.
+ *
+ * Module-wide reporting parameters are followed by a block of
+ * MODULE_CONFIGURATION_CHANNEL_SIZE bytes for each temperature
+ * channel. MODULE_CONFIGURATION_CHANNEL_INDEX(c, o) returns the
+ * configuration index of field o in the block for channel c.
+ *
+ * A channel's delta threshold is the change in temperature since the
+ * last transmission (in tenths of a degree) which triggers an
+ * immediate transmission; its rate threshold is the rate of change (in
+ * tenths of a degree per minute) which does the same. Setting either
+ * threshold to zero disables the associated trigger.
+ */
+#define MODULE_CONFIGURATION_PGN130316_HEARTBEAT_PERIOD_INDEX 1   // Index of PGN 130316 heartbeat period in seconds
+#define MODULE_CONFIGURATION_PGN130316_HOLDOFF_INDEX 2            // Index of minimum interval between event transmissions in 100s of milli-seconds
+#define MODULE_CONFIGURATION_CHANNEL_BASE_INDEX 3                 // Index of first channel configuration block
+
+#define PGN130316_HEARTBEAT_PERIOD_UNIT 1000UL                    // Milliseconds per unit of heartbeat period
+#define PGN130316_HOLDOFF_UNIT 100UL                              // Milliseconds per unit of holdoff
+
+#define MODULE_CONFIGURATION_CHANNEL_SIZE 3                       // Size of each channel configuration block in bytes
+#define MODULE_CONFIGURATION_CHANNEL_SOURCE_OFFSET 0              // Offset of channel N2K temperature source
+#define MODULE_CONFIGURATION_CHANNEL_DELTA_OFFSET 1               // Offset of channel delta threshold in 0.1 degrees
+#define MODULE_CONFIGURATION_CHANNEL_RATE_OFFSET 2                // Offset of channel rate threshold in 0.1 degrees per minute
+
+#define MODULE_CONFIGURATION_CHANNEL_INDEX(c, o) (MODULE_CONFIGURATION_CHANNEL_BASE_INDEX + ((c) * MODULE_CONFIGURATION_CHANNEL_SIZE) + (o))
+
+/**********************************************************************
+ * @brief NOP100 function overrides.
+ */
+#define ON_N2K_OPEN
+#define ON_BUS_LOAD_CHANGE
+
+/**********************************************************************
+ * @brief Configuration of the attached Click 1892 module.
+ *
+ * MIKROE1892_I2C_ADDRESS depends upon the ADDR SEL jumpers on the
+ * Click card.
+ */
+#define MIKROE1892_I2C_ADDRESS 0x18
+
+/**********************************************************************
+ * @brief Temperature acquisition timing.
+ *
+ * TEMPERATURE_SAMPLE_INTERVAL is the number of milliseconds between
+ * the start of successive DS18B20 conversions and must be greater than
+ * TEMPERATURE_CONVERSION_TIME (750ms for 12-bit resolution).
+ *
+ * TEMPERATURE_RATE_WINDOW is the number of milliseconds over which a
+ * channel's rate of change is measured: short windows make the rate
+ * trigger jumpy at the DS18B20's 0.0625 degree resolution.
+ */
+#define TEMPERATURE_SAMPLE_INTERVAL 1000UL
+#define TEMPERATURE_CONVERSION_TIME 750UL
+#define TEMPERATURE_RATE_WINDOW 15000UL
+
+/**********************************************************************
+ * @brief DS18B20 power-on reset value.
+ *
+ * TEMPERATURE_POWER_ON_RESET_VALUE is the raw scratchpad value (85
+ * degrees) which a sensor returns after a reset. It is accepted only
+ * if the channel's previous reading lay within
+ * TEMPERATURE_POWER_ON_RESET_MARGIN degrees of it.
+ */
+#define TEMPERATURE_POWER_ON_RESET_VALUE 0x0550
+#define TEMPERATURE_POWER_ON_RESET_MARGIN 2.0
@@ -0,0 +1,515 @@
+/**
+ * @file definitions.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Everything required to implement NOP100-TSM.
+ * @version 0.1
+ * @date 2024-08-01
+ * @copyright Copyright (c) 2024
+ */
+
+/**********************************************************************
+ * @brief Minimal driver for the DS2482-100 I2C to 1-Wire bridge used
+ * on the Click 1892 module.
+ *
+ * Start-up operations (device reset, configuration and bus search)
+ * block, but run-time 1-Wire traffic is expressed as a short script of
+ * reset, write and read steps which poll() advances through a series
+ * of asynchronous PeripheralIO transactions, so that neither the I2C
+ * bus nor a slow 1-Wire bus ever holds up loop().
+ */
+class DS2482 {
+  public:
+    enum tOperation : uint8_t { OP_RESET, OP_WRITE, OP_READ };
+    typedef struct { tOperation operation; uint8_t value; } tStep;
+
+    static const unsigned int MAX_STEPS = 20;
+    static const unsigned int ROM_SIZE = 8;
+
+    DS2482(uint8_t address) : address(address), stepCount(0), stepIndex(0), phase(PHASE_COMMAND), presence(false), readCount(0) {
+      this->transaction.bus = PeripheralIO::BUS_I2C;
+      this->transaction.device = address;
+      this->transaction.txBuffer = this->txBuffer;
+      this->transaction.rxBuffer = this->rxBuffer;
+      this->transaction.callback = 0;
+      this->transaction.status = PeripheralIO::STATUS_IDLE;
+    }
+
+    bool begin() {
+      this->command(0xF0);
+      delayMicroseconds(10);
+      if (this->waitWhileBusy() & STATUS_RST) {
+        this->command(0xD2, 0xE1); // Active pull-up
+        return(true);
+      }
+      return(false);
+    }
+
+    /******************************************************************
+     * @brief Search the 1-Wire bus and save the ROM codes of up to max
+     * devices into roms.
+     *
+     * @return The number of devices discovered.
+     */
+    unsigned int search(uint8_t roms[][ROM_SIZE], unsigned int max) {
+      uint8_t rom[ROM_SIZE] = { 0 };
+      int lastDiscrepancy = -1;
+      unsigned int count = 0;
+
+      do {
+        int discrepancy = -1;
+
+        this->command(0xB4);
+        if (!(this->waitWhileBusy() & STATUS_PPD)) break;
+        this->command(0xA5, 0xF0); this->waitWhileBusy();
+        for (int bit = 0; bit < 64; bit++) {
+          uint8_t *byte = &rom[bit / 8];
+          uint8_t mask = (1 << (bit % 8));
+          bool direction = (bit < lastDiscrepancy)?(*byte & mask):(bit == lastDiscrepancy);
+
+          this->command(0x78, (direction)?0x80:0x00);
+          uint8_t status = this->waitWhileBusy();
+          if ((status & STATUS_SBR) && (status & STATUS_TSB)) return(count);
+          if (!(status & STATUS_SBR) && !(status & STATUS_TSB) && !(status & STATUS_DIR)) discrepancy = bit;
+          *byte = (status & STATUS_DIR)?(*byte | mask):(*byte & ~mask);
+        }
+        if (crc8(rom, ROM_SIZE) == 0) memcpy(roms[count++], rom, ROM_SIZE);
+        lastDiscrepancy = discrepancy;
+      } while ((lastDiscrepancy >= 0) && (count < max));
+      return(count);
+    }
+
+    /******************************************************************
+     * @brief Start execution of a 1-Wire script.
+     *
+     * @return false if a script is already in progress.
+     */
+    bool run(const tStep *steps, unsigned int count) {
+      if ((!this->isIdle()) || (count > MAX_STEPS)) return(false);
+      memcpy(this->steps, steps, (count * sizeof(tStep)));
+      this->stepCount = count;
+      this->stepIndex = 0;
+      this->phase = PHASE_COMMAND;
+      this->readCount = 0;
+      this->presence = true;
+      return(true);
+    }
+
+    /******************************************************************
+     * @brief Advance any running script by at most one transaction.
+     *
+     * Each step writes its command, then polls the status register
+     * until the bridge is no longer busy and, for a read step, fetches
+     * the received byte from the data register. An I2C error abandons
+     * the script with presence cleared.
+     *
+     * @return true on the call which completes the script.
+     */
+    bool poll() {
+      if ((this->isIdle()) || (PeripheralBus.isBusy(this->transaction))) return(false);
+      if (this->transaction.status == PeripheralIO::STATUS_ERROR) {
+        this->transaction.status = PeripheralIO::STATUS_IDLE;
+        this->presence = false;
+        this->stepIndex = this->stepCount;
+        return(true);
+      }
+      switch (this->phase) {
+        case PHASE_COMMAND:
+          switch (this->steps[this->stepIndex].operation) {
+            case OP_RESET: this->submit(0xB4); break;
+            case OP_WRITE: this->submit(0xA5, this->steps[this->stepIndex].value); break;
+            case OP_READ: this->submit(0x96); break;
+          }
+          this->phase = PHASE_STATUS;
+          break;
+        case PHASE_STATUS:
+          this->submitRead();
+          this->phase = PHASE_BUSY;
+          break;
+        case PHASE_BUSY:
+          if (this->rxBuffer[0] & STATUS_1WB) {
+            this->submitRead();
+            break;
+          }
+          if (this->steps[this->stepIndex].operation == OP_RESET) this->presence = this->presence && (this->rxBuffer[0] & STATUS_PPD);
+          if (this->steps[this->stepIndex].operation == OP_READ) {
+            this->submit(0xE1, 0xE1, 1);
+            this->phase = PHASE_DATA;
+            break;
+          }
+          return(this->nextStep());
+        case PHASE_DATA:
+          this->readBuffer[this->readCount++] = this->rxBuffer[0];
+          return(this->nextStep());
+      }
+      return(false);
+    }
+
+    bool isIdle() { return(this->stepIndex >= this->stepCount); }
+    bool getPresence() { return(this->presence); }
+    const uint8_t *getReadBuffer() { return(this->readBuffer); }
+    unsigned int getReadCount() { return(this->readCount); }
+
+    static uint8_t crc8(const uint8_t *data, unsigned int length) {
+      uint8_t crc = 0;
+      while (length--) {
+        uint8_t byte = *data++;
+        for (int i = 0; i < 8; i++, byte >>= 1) crc = ((crc ^ byte) & 0x01)?((crc >> 1) ^ 0x8C):(crc >> 1);
+      }
+      return(crc);
+    }
+
+  private:
+    static const uint8_t STATUS_1WB = 0x01;
+    static const uint8_t STATUS_PPD = 0x02;
+    static const uint8_t STATUS_RST = 0x10;
+    static const uint8_t STATUS_SBR = 0x20;
+    static const uint8_t STATUS_TSB = 0x40;
+    static const uint8_t STATUS_DIR = 0x80;
+
+    enum tPhase : uint8_t { PHASE_COMMAND, PHASE_STATUS, PHASE_BUSY, PHASE_DATA };
+
+    uint8_t address;
+    tStep steps[MAX_STEPS];
+    unsigned int stepCount;
+    unsigned int stepIndex;
+    tPhase phase;
+    bool presence;
+    uint8_t readBuffer[MAX_STEPS];
+    unsigned int readCount;
+    PeripheralIO::tTransaction transaction;
+    uint8_t txBuffer[2];
+    uint8_t rxBuffer[1];
+
+    bool nextStep() {
+      this->phase = PHASE_COMMAND;
+      return(++this->stepIndex == this->stepCount);
+    }
+
+    void submit(uint8_t command, uint8_t parameter = 0, size_t rxCount = 0) {
+      this->txBuffer[0] = command;
+      this->txBuffer[1] = parameter;
+      this->transaction.txCount = ((command == 0xA5) || (command == 0xE1))?2:1;
+      this->transaction.rxCount = rxCount;
+      PeripheralBus.submit(this->transaction);
+    }
+
+    void submitRead() {
+      this->transaction.txCount = 0;
+      this->transaction.rxCount = 1;
+      PeripheralBus.submit(this->transaction);
+    }
+
+    void command(uint8_t command) {
+      Wire.beginTransmission(this->address); Wire.write(command); Wire.endTransmission();
+    }
+
+    void command(uint8_t command, uint8_t parameter) {
+      Wire.beginTransmission(this->address); Wire.write(command); Wire.write(parameter); Wire.endTransmission();
+    }
+
+    uint8_t readRegister() {
+      Wire.requestFrom(this->address, (uint8_t) 1);
+      return((Wire.available())?Wire.read():0);
+    }
+
+    uint8_t waitWhileBusy() {
+      uint8_t status;
+      unsigned long start = millis();
+      while (((status = this->readRegister()) & STATUS_1WB) && ((millis() - start) < 10));
+      return(status);
+    }
+};
+
+/**
+ * @brief Interface to the Click 1892 MikroBus module.
+ */
+DS2482 OneWireBridge(MIKROE1892_I2C_ADDRESS);
+
+/**
+ * @brief ROM codes of the DS18B20 sensors discovered at startup.
+ *
+ * Sensors are assigned to channels in the order that they are found
+ * by the 1-Wire search algorithm, which is stable for a given set of
+ * sensors.
+ */
+uint8_t SensorRoms[TEMPERATURE_CHANNEL_COUNT][DS2482::ROM_SIZE];
+unsigned int SensorCount = 0;
+
+/**
+ * @brief Per-channel state of the adaptive reporting engine.
+ *
+ * Temperatures are held in Kelvin ready for use in a PGN 130316
+ * message.
+ */
+typedef struct {
+  bool valid;                           // Set once temperature holds a good sample
+  double temperature;                   // Most recent sample
+  double reportedTemperature;           // Temperature at last transmission
+  unsigned long reportedAt;             // Time of last transmission
+  double rateReference;                 // Temperature at start of rate window
+  unsigned long rateReferenceAt;        // Time at start of rate window
+  double rate;                          // Rate of change in degrees per minute
+  bool rateUpdated;                     // Set when rate is measured and cleared once it has been acted upon
+  unsigned long nextHeartbeat;          // Time of next unconditional transmission
+} tTemperatureChannel;
+
+tTemperatureChannel TemperatureChannels[TEMPERATURE_CHANNEL_COUNT];
+
+/**
+ * @brief Acquisition state machine which drives the 1-Wire bus.
+ */
+enum { ACQUISITION_IDLE, ACQUISITION_CONVERTING, ACQUISITION_READING } AcquisitionState = ACQUISITION_IDLE;
+unsigned long AcquisitionStartedAt = 0;
+unsigned int AcquisitionChannel = 0;
+
+/**
+ * @brief Transmit PGN 130316 for a single channel and flash transmit
+ * LED.
+ *
+ * The message instance is derived from the module instance address
+ * set on the hardware code switches offset by the channel number. A
+ * channel whose instance would exceed 254 is not transmitted.
+ */
+void transmitPGN130316(unsigned int channel) {
+  #ifdef DEBUG_SERIAL
+  Serial.print("transmitPGN130316("); Serial.print(channel); Serial.println(")...");
+  #endif
+  static tN2kMsg N2kMsg;
+
+  unsigned char instance = (unsigned char) CodeSwitchPISO.read();
+
+  if ((instance + channel) < 255) {
+    SetN2kPGN130316(
+      N2kMsg,
+      0xff,
+      (unsigned char) (instance + channel),
+      (tN2kTempSource) ModuleConfiguration.getByte(MODULE_CONFIGURATION_CHANNEL_INDEX(channel, MODULE_CONFIGURATION_CHANNEL_SOURCE_OFFSET)),
+      (TemperatureChannels[channel].valid)?TemperatureChannels[channel].temperature:N2kDoubleNA
+    );
+    transmitMessage(N2kMsg);
+    CanLed.setLedState(0, LedManager::ONCE);
+  }
+}
+
+/**********************************************************************
+ * @brief Decide whether a channel needs reporting and, if so, report
+ * it.
+ *
+ * A channel is reported immediately if its temperature has moved by
+ * more than its delta threshold since it was last reported or if a
+ * newly measured rate of change exceeds its rate threshold, subject to
+ * a module-wide hold-off which stops a wildly fluctuating channel from
+ * flooding the bus. Otherwise the channel is reported when its
+ * heartbeat falls due.
+ *
+ * The rate is measured once per TEMPERATURE_RATE_WINDOW and each
+ * measurement can trigger at most one report, so a channel which has
+ * stopped moving is not reported again on every sample until the next
+ * measurement.
+ *
+ * Heartbeats are advanced in whole periods so that each channel keeps
+ * the slot it was given by initialiseTemperatureChannels() and the
+ * module's heartbeat traffic stays staggered across the period. The
+ * period is stretched when the bus is busy; event reports are not
+ * delayed.
+ *
+ * @param channel - the channel to be processed.
+ * @param now - the current time in milliseconds.
+ */
+void processTemperatureChannel(unsigned int channel, unsigned long now) {
+  tTemperatureChannel *c = &TemperatureChannels[channel];
+  unsigned long period = BusLoad.stretch((unsigned long) ModuleConfiguration.getByte(MODULE_CONFIGURATION_PGN130316_HEARTBEAT_PERIOD_INDEX) * PGN130316_HEARTBEAT_PERIOD_UNIT);
+  unsigned long holdoff = (unsigned long) ModuleConfiguration.getByte(MODULE_CONFIGURATION_PGN130316_HOLDOFF_INDEX) * PGN130316_HOLDOFF_UNIT;
+  double delta = ModuleConfiguration.getByte(MODULE_CONFIGURATION_CHANNEL_INDEX(channel, MODULE_CONFIGURATION_CHANNEL_DELTA_OFFSET)) / 10.0;
+  double rate = ModuleConfiguration.getByte(MODULE_CONFIGURATION_CHANNEL_INDEX(channel, MODULE_CONFIGURATION_CHANNEL_RATE_OFFSET)) / 10.0;
+  bool heartbeat = ((long) (now - c->nextHeartbeat) >= 0);
+  bool event = false;
+
+  if ((c->valid) && ((now - c->reportedAt) >= holdoff)) {
+    event = ((delta > 0.0) && (fabs(c->temperature - c->reportedTemperature) >= delta));
+    event = event || ((rate > 0.0) && (c->rateUpdated) && (fabs(c->rate) >= rate));
+    c->rateUpdated = false;
+  }
+
+  if (event || heartbeat) {
+    transmitPGN130316(channel);
+    c->rateUpdated = false;
+    c->reportedTemperature = c->temperature;
+    c->reportedAt = now;
+    if (period > 0) while ((long) (now - c->nextHeartbeat) >= 0) c->nextHeartbeat += period;
+  }
+}
+
+/**********************************************************************
+ * @brief Record a new sample for a channel and update its rate of
+ * change.
+ *
+ * @param channel - the channel which has been sampled.
+ * @param temperature - the new sample in Kelvin.
+ * @param now - the current time in milliseconds.
+ */
+void updateTemperatureChannel(unsigned int channel, double temperature, unsigned long now) {
+  tTemperatureChannel *c = &TemperatureChannels[channel];
+
+  if (!c->valid) {
+    c->valid = true;
+    c->reportedTemperature = temperature;
+    c->rateReference = temperature;
+    c->rateReferenceAt = now;
+  }
+  c->temperature = temperature;
+  if ((now - c->rateReferenceAt) >= TEMPERATURE_RATE_WINDOW) {
+    c->rate = ((temperature - c->rateReference) * 60000.0) / (now - c->rateReferenceAt);
+    c->rateUpdated = true;
+    c->rateReference = temperature;
+    c->rateReferenceAt = now;
+  }
+}
+
+/**********************************************************************
+ * @brief Check for a DS18B20 power-on reset value.
+ *
+ * A sensor which has browned out, or which missed the strong pull-up
+ * during conversion, returns its power-on reset value of 85 degrees
+ * with a good CRC. Such a reading is discarded unless the channel's
+ * previous reading was within TEMPERATURE_POWER_ON_RESET_MARGIN of
+ * 85 degrees, so that it never triggers an event report.
+ *
+ * @param channel - the channel which has been sampled.
+ * @param raw - the raw scratchpad temperature in 1/16 degree.
+ * @return true if the reading should be discarded.
+ */
+bool isPowerOnResetValue(unsigned int channel, int16_t raw) {
+  tTemperatureChannel *c = &TemperatureChannels[channel];
+
+  if (raw != TEMPERATURE_POWER_ON_RESET_VALUE) return(false);
+  return(!((c->valid) && (fabs(c->temperature - CToKelvin(TEMPERATURE_POWER_ON_RESET_VALUE / 16.0)) <= TEMPERATURE_POWER_ON_RESET_MARGIN)));
+}
+
+/**********************************************************************
+ * @brief Stagger the heartbeats of channels with a sensor evenly
+ * across the configured heartbeat period, stretched when the bus is
+ * busy.
+ *
+ * Also called whenever the heartbeat period or the bus load stretch
+ * factor is changed, so that a new period takes effect at once rather
+ * than after the remainder of the old one. Channels with no sensor are
+ * never processed and so never transmitted.
+ */
+void scheduleTemperatureHeartbeats() {
+  unsigned long now = millis();
+  unsigned long period = BusLoad.stretch((unsigned long) ModuleConfiguration.getByte(MODULE_CONFIGURATION_PGN130316_HEARTBEAT_PERIOD_INDEX) * PGN130316_HEARTBEAT_PERIOD_UNIT);
+
+  for (unsigned int c = 0; c < SensorCount; c++) {
+    TemperatureChannels[c].nextHeartbeat = now + ((period * (c + 1)) / SensorCount);
+  }
+}
+
+/**********************************************************************
+ * @brief ConfigurationChanges handler which reschedules the heartbeats
+ * when their period is changed.
+ */
+void onHeartbeatPeriodChange(unsigned int index, unsigned char value) {
+  scheduleTemperatureHeartbeats();
+}
+
+/**********************************************************************
+ * @brief Reset all channels and stagger their heartbeats.
+ */
+void initialiseTemperatureChannels() {
+  unsigned long now = millis();
+
+  for (unsigned int c = 0; c < TEMPERATURE_CHANNEL_COUNT; c++) {
+    TemperatureChannels[c].valid = false;
+    TemperatureChannels[c].rate = 0.0;
+    TemperatureChannels[c].rateUpdated = false;
+    TemperatureChannels[c].reportedAt = now;
+  }
+  scheduleTemperatureHeartbeats();
+}
+
+/**********************************************************************
+ * @brief Advance the temperature acquisition state machine.
+ *
+ * A conversion is started on all sensors at once, after which each
+ * sensor's scratchpad is read in turn. Each sensor is processed by the
+ * reporting engine as soon as its sample arrives, so event reports are
+ * not held back waiting for the whole bank to be read.
+ */
+void acquireTemperaturesMaybe() {
+  static const DS2482::tStep convert[] = {
+    { DS2482::OP_RESET, 0 }, { DS2482::OP_WRITE, 0xCC }, { DS2482::OP_WRITE, 0x44 }
+  };
+  DS2482::tStep read[DS2482::MAX_STEPS];
+  unsigned long now = millis();
+
+  switch (AcquisitionState) {
+    case ACQUISITION_IDLE:
+      if ((SensorCount > 0) && ((now - AcquisitionStartedAt) >= TEMPERATURE_SAMPLE_INTERVAL)) {
+        if (OneWireBridge.run(convert, (sizeof(convert) / sizeof(convert[0])))) {
+          AcquisitionStartedAt = now;
+          AcquisitionState = ACQUISITION_CONVERTING;
+        }
+      }
+      break;
+    case ACQUISITION_CONVERTING:
+      OneWireBridge.poll();
+      if ((OneWireBridge.isIdle()) && ((now - AcquisitionStartedAt) >= TEMPERATURE_CONVERSION_TIME)) {
+        AcquisitionChannel = 0;
+        AcquisitionState = ACQUISITION_READING;
+      }
+      break;
+    case ACQUISITION_READING:
+      if (OneWireBridge.isIdle()) {
+        unsigned int n = 0;
+        read[n++] = { DS2482::OP_RESET, 0 };
+        read[n++] = { DS2482::OP_WRITE, 0x55 };
+        for (unsigned int i = 0; i < DS2482::ROM_SIZE; i++) read[n++] = { DS2482::OP_WRITE, SensorRoms[AcquisitionChannel][i] };
+        read[n++] = { DS2482::OP_WRITE, 0xBE };
+        for (unsigned int i = 0; i < 9; i++) read[n++] = { DS2482::OP_READ, 0 };
+        OneWireBridge.run(read, n);
+      } else if (OneWireBridge.poll()) {
+        const uint8_t *scratchpad = OneWireBridge.getReadBuffer();
+        if ((OneWireBridge.getPresence()) && (DS2482::crc8(scratchpad, 9) == 0)) {
+          int16_t raw = (int16_t) ((scratchpad[1] << 8) | scratchpad[0]);
+          if (!isPowerOnResetValue(AcquisitionChannel, raw)) updateTemperatureChannel(AcquisitionChannel, CToKelvin(raw / 16.0), now);
+        } else {
+          TemperatureChannels[AcquisitionChannel].valid = false;
+        }
+        processTemperatureChannel(AcquisitionChannel, now);
+        if (++AcquisitionChannel == SensorCount) AcquisitionState = ACQUISITION_IDLE;
+      }
+      break;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////
+// The following functions override the defaults provided in NOP100. //
+///////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Callback invoked when N2K bus connection becomes active.
+ *
+ * Reset the reporting engine so that heartbeats are staggered from
+ * the moment the module goes live on the bus.
+ *
+ * @note Overrides the eponymous function in NOP100.
+ */
+void onN2kOpen() {
+  #ifdef DEBUG_SERIAL
+  Serial.println("OnN2kOpen()...");
+  #endif
+
+  initialiseTemperatureChannels();
+}
+
+/**
+ * @brief Callback invoked when the bus load stretch factor changes.
+ *
+ * Restagger heartbeats over the newly stretched period.
+ *
+ * @note Overrides the eponymous function in NOP100.
+ */
+void onBusLoadChange() {
+  scheduleTemperatureHeartbeats();
+}
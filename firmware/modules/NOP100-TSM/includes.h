@@ -0,0 +1,13 @@
+/**
+ * @file includes.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief #include directives for required library headers.
+ * @version 0.1
+ * @date 2024-08-01
+ * 
+ * @copyright Copyright (c) 2024
+ */
+
+#include <i2c_driver_wire.h>
+#include "PeripheralIO.h"
+
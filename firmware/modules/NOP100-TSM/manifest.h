@@ -0,0 +1,48 @@
+/**
+ * @file manifest.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Manifest of the messages, configuration and periodic
+ * transmissions of NOP100-TSM.
+ * @version 0.1
+ * @date 2024-09-16
+ * @copyright Copyright (c) 2024
+ */
+
+void onHeartbeatPeriodChange(unsigned int index, unsigned char value);
+
+/**
+ * @brief Manifest of one temperature channel's configuration block.
+ */
+#define TEMPERATURE_CHANNEL_MANIFEST \
+  { 0x03, 0, 14 },                      /* Source: N2kts_EngineRoomTemperature */ \
+  { 0x05, 0, 255 },                     /* Delta: 0.5 degrees */ \
+  { 0x14, 0, 255 }                      /* Rate: 2.0 degrees per minute */
+
+namespace ModuleManifest {
+
+  constexpr unsigned long TransmittedPGNs[] = { 130316L, 0 };
+
+  constexpr tManifestReceivedPGN ReceivedPGNs[] = { { 0L, 0 } };
+
+  constexpr tManifestConfigurationByte Configuration[] = {
+    MODULE_CONFIGURATION_CAN_SOURCE_MANIFEST,
+    { 0x3C, 1, 255 },                   // PGN 130316 heartbeat period: every sixty seconds
+    { 0x0A, 0, 255 },                   // Holdoff: ten times 100 milliseconds
+    TEMPERATURE_CHANNEL_MANIFEST,
+    TEMPERATURE_CHANNEL_MANIFEST,
+    TEMPERATURE_CHANNEL_MANIFEST,
+    TEMPERATURE_CHANNEL_MANIFEST,
+    TEMPERATURE_CHANNEL_MANIFEST,
+    TEMPERATURE_CHANNEL_MANIFEST,
+    TEMPERATURE_CHANNEL_MANIFEST,
+    TEMPERATURE_CHANNEL_MANIFEST
+  };
+
+  constexpr tManifestScheduler Schedulers[] = { { 0, 0, 0, 0, 0 } };
+
+  constexpr tManifestSubscriber Subscribers[] = {
+    { MODULE_CONFIGURATION_PGN130316_HEARTBEAT_PERIOD_INDEX, MODULE_CONFIGURATION_PGN130316_HEARTBEAT_PERIOD_INDEX, onHeartbeatPeriodChange },
+    { 0, 0, 0 }
+  };
+
+}
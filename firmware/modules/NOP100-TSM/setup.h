@@ -0,0 +1,14 @@
+/**
+ * @file setup.h
+ * @author Paul Reeve (preeve@pdjr.eu)
+ * @brief Code to be executed in Arduino setup().
+ * @version 0.1
+ * @date 2024-08-01
+ * @copyright Copyright (c) 2024
+ */
+
+Wire.begin();
+
+if (OneWireBridge.begin()) SensorCount = OneWireBridge.search(SensorRoms, TEMPERATURE_CHANNEL_COUNT);
+
+initialiseTemperatureChannels();